@@ -0,0 +1,256 @@
+#include "BidirectionalSolver.h"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+
+#include "Solution.h"
+
+BidirectionalSolver::Frontier::Frontier(
+    Board &board,
+    const SimpleDeadlockDetector &simpleDeadlockDetector,
+    const std::vector<Position> &targets,
+    const SolverOptions &options,
+    bool backward)
+    : board(board),
+      // N.B., bitboards assume the player stays in the initial player's
+      // region, which does not hold for boards searched backwards.
+      pushSearcher(board,
+                   simpleDeadlockDetector,
+                   nullptr,
+                   backward ? Reachability::DFS : options.reachability),
+      distanceTable(board,
+                    targets,
+                    backward ? BoxMove::PULL : BoxMove::PUSH,
+                    options.heuristic,
+                    backward ? nullptr : options.patternDatabase),
+      states(board),
+      stateTable(states),
+      openList(OpenList::Create(options.openList, options.tieBreak)),
+      backward(backward) {}
+
+BidirectionalSolver::BidirectionalSolver(Board &board,
+                                         const SolverOptions &options)
+    : board(board),
+      backwardBoard(board),
+      simpleDeadlockDetector(board),
+      freezeDeadlockDetector(board, simpleDeadlockDetector),
+      forward(board, simpleDeadlockDetector, board.Goals(), options, false),
+      backward(backwardBoard,
+               simpleDeadlockDetector,
+               board.Boxes(),
+               options,
+               true),
+      options(options),
+      statesVisited(0),
+      solutionPushes(INT_MAX),
+      meetingFrontier(nullptr),
+      meetingParent(NO_STATE),
+      meetingMove(0),
+      meetingOpposite(NO_STATE) {}
+
+SolveResult BidirectionalSolver::Solve() {
+  if (board.Done()) {
+    return SolveResult(true, 0, 0, 0);
+  }
+
+  // Add the initial forward state.
+  Position initialPlayer = board.Player();
+  std::vector<Position> initialBoxes = board.Boxes();
+  Push noMove(0, Direction::UP);
+  board.MovePlayer(forward.pushSearcher.FindNormalizedPlayer());
+  Offer(forward, backward, 0, NO_STATE, noMove);
+
+  // Add a solved state for every player region left by boxes on goals.
+  Position anyPlayer = board.Player();
+  for (Position p = 0; p < board.Size(); p++) {
+    if (board.IsInterior(p) && !board.HasGoal(p)) {
+      anyPlayer = p;
+      break;
+    }
+  }
+  backwardBoard.ResetState(anyPlayer, board.Goals());
+  std::vector<bool> visited(board.Size(), false);
+  std::vector<Position> stack;
+  for (Position start = 0; start < board.Size(); start++) {
+    if (!board.IsInterior(start) || visited[start] ||
+        backwardBoard.HasBox(start)) {
+      continue;
+    }
+    stack.push_back(start);
+    while (!stack.empty()) {
+      Position p = stack.back();
+      stack.pop_back();
+      if (visited[p]) {
+        continue;
+      }
+      visited[p] = true;
+      for (Direction d : ALL_DIRECTIONS) {
+        Position p2 = backwardBoard.MovePosition(p, d);
+        if (!visited[p2] && !backwardBoard.HasWall(p2) &&
+            !backwardBoard.HasBox(p2)) {
+          stack.push_back(p2);
+        }
+      }
+    }
+
+    // N.B., positions are scanned in order, so the region's first position
+    // is also its normalized player position.
+    backwardBoard.MovePlayer(start);
+    Offer(backward, forward, 0, NO_STATE, noMove);
+  }
+
+  // Expand the smaller frontier until no open state can improve on the
+  // cheapest meeting point. Once either search is exhausted, every solution
+  // has been seen by both.
+  while (!forward.openList->Empty() && !backward.openList->Empty() &&
+         statesVisited < options.maxStates) {
+    bool expandForward =
+        forward.openList->Size() <= backward.openList->Size();
+    if (!(expandForward ? Expand(forward, backward)
+                        : Expand(backward, forward))) {
+      break;
+    }
+  }
+
+  size_t memoryUsed = 0;
+  for (Frontier *frontier : {&forward, &backward}) {
+    memoryUsed += frontier->states.MemoryUsage() +
+                  frontier->stateTable.MemoryUsage() +
+                  frontier->openList->MemoryUsage();
+  }
+  bool solved = solutionPushes != INT_MAX;
+  SolveResult result(solved, statesVisited, solved ? solutionPushes : -1,
+                     memoryUsed);
+
+  // Recover the solution from the initial state.
+  if (solved) {
+    std::vector<Push> path;
+    GetSolution(path);
+    board.ResetState(initialPlayer, initialBoxes);
+    result.solution = ExpandPushes(board, path);
+  }
+  return result;
+}
+
+void BidirectionalSolver::GetSolution(std::vector<Push> &path) {
+  // Find the forward path to the meeting point, and the backward path from
+  // it to a solved state. N.B., backward paths consist of pulls, which
+  // replayed in reverse are exactly the pushes undone by them.
+  std::vector<Push> backwardPath;
+  Push move = StateStore::DecodePush(meetingMove);
+  if (meetingFrontier == &forward) {
+    forward.states.GetPath(meetingParent, path);
+    path.push_back(move);
+    backward.states.GetPath(meetingOpposite, backwardPath);
+  } else {
+    forward.states.GetPath(meetingOpposite, path);
+    backward.states.GetPath(meetingParent, backwardPath);
+    backwardPath.push_back(move);
+  }
+  path.insert(path.end(), backwardPath.rbegin(), backwardPath.rend());
+}
+
+bool BidirectionalSolver::Expand(Frontier &frontier, Frontier &opposite) {
+  StateId id = frontier.openList->Pop();
+  if (frontier.states.FValue(id) >= solutionPushes) {
+    return false;
+  }
+
+  // Move from open list to closed list.
+  Board &board = frontier.board;
+  frontier.states.Restore(id, board);
+  StateTableSlot *slot = frontier.stateTable.Find(board.Hash(), id);
+  assert(slot && slot->status == StateStatus::OPEN);
+  slot->status = StateStatus::CLOSED;
+  int gValue = frontier.states.GValue(id);
+  statesVisited++;
+
+  // Generate children.
+  if (frontier.backward) {
+    frontier.pushSearcher.FindPulls(frontier.moves);
+  } else {
+    frontier.pushSearcher.FindPushes(frontier.moves);
+  }
+  for (const Push &p : frontier.moves) {
+    if (frontier.backward) {
+      board.PerformUnpush(p);
+    } else {
+      board.PerformPush(p);
+
+      // Check for potential freeze deadlock.
+      Position boxTo = board.MovePosition(p.Box(), p.Direction());
+      if (freezeDeadlockDetector.IsDeadlock(boxTo)) {
+        board.PerformUnpush(p);
+        continue;
+      }
+    }
+
+    board.MovePlayer(frontier.pushSearcher.FindNormalizedPlayer());
+    Offer(frontier, opposite, gValue + 1, id, p);
+
+    if (frontier.backward) {
+      board.PerformPush(p);
+    } else {
+      board.PerformUnpush(p);
+    }
+  }
+  return true;
+}
+
+void BidirectionalSolver::Offer(Frontier &frontier,
+                                Frontier &opposite,
+                                int gValue,
+                                StateId parent,
+                                const Push &move) {
+  const Board &board = frontier.board;
+  uint64_t hash = board.Hash();
+
+  // Check whether the opposite search has already reached this state.
+  opposite.states.Pack(board);
+  StateTableSlot *meeting = opposite.stateTable.Find(hash);
+  if (meeting &&
+      gValue + opposite.states.GValue(meeting->id) < solutionPushes) {
+    // N.B., initial states only meet if the level starts solved.
+    assert(parent != NO_STATE);
+    solutionPushes = gValue + opposite.states.GValue(meeting->id);
+    meetingFrontier = &frontier;
+    meetingParent = parent;
+    meetingMove = StateStore::EncodePush(move);
+    meetingOpposite = meeting->id;
+  }
+
+  // Check if the state already exists in this search.
+  frontier.states.Pack(board);
+  StateTableSlot *slot = frontier.stateTable.Find(hash);
+  if (slot) {
+    StateId id = slot->id;
+    bool isClosed = slot->status == StateStatus::CLOSED;
+    if (gValue >= frontier.states.GValue(id) ||
+        (isClosed && !options.reopenClosed)) {
+      return;
+    }
+    int hValue = frontier.states.HValue(id);
+    frontier.states.SetGValue(id, gValue);
+    frontier.states.SetParent(id, parent, move);
+    if (isClosed) {
+      slot->status = StateStatus::OPEN;
+      frontier.openList->Push(id, gValue + hValue, gValue, hValue);
+    } else {
+      frontier.openList->Update(id, gValue + hValue, gValue, hValue);
+    }
+    return;
+  }
+
+  // Add open state, unless it cannot lead to a cheaper solution.
+  int hValue = frontier.distanceTable.EstimateDistance(board.Boxes());
+  if (gValue + hValue >= solutionPushes) {
+    return;
+  }
+  StateId id = frontier.states.Add(noPushes, gValue, hValue, false);
+  if (parent != NO_STATE) {
+    frontier.states.SetParent(id, parent, move);
+  }
+  frontier.openList->Push(id, gValue + hValue, gValue, hValue);
+  frontier.stateTable.Insert(hash, id, StateStatus::OPEN);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Board.h"
+#include "DistanceTable.h"
+#include "FreezeDeadlockDetector.h"
+#include "OpenList.h"
+#include "PushSearcher.h"
+#include "SimpleDeadlockDetector.h"
+#include "SolveResult.h"
+#include "SolverOptions.h"
+#include "StateStore.h"
+#include "StateTable.h"
+
+// Bidirectional A*. A forward search from the initial state using pushes is
+// interleaved with a backward search from the solved states (one per player
+// region) using pulls. Every generated state is looked up in the opposite
+// search's state table; the search stops once no open state in either
+// direction can improve on the cheapest meeting point found.
+class BidirectionalSolver {
+public:
+  BidirectionalSolver(Board &board, const SolverOptions &options);
+
+  SolveResult Solve();
+
+private:
+  struct Frontier {
+    Frontier(Board &board,
+             const SimpleDeadlockDetector &simpleDeadlockDetector,
+             const std::vector<Position> &targets,
+             const SolverOptions &options,
+             bool backward);
+
+    Board &board;
+    PushSearcher pushSearcher;
+    DistanceTable distanceTable;
+    StateStore states;
+    StateTable stateTable;
+    std::unique_ptr<OpenList> openList;
+    std::vector<Push> moves;
+    bool backward;
+  };
+
+  void AddInitialStates(Frontier &frontier, const std::vector<Position> &boxes);
+  bool Expand(Frontier &frontier, Frontier &opposite);
+  void Offer(Frontier &frontier,
+             Frontier &opposite,
+             int gValue,
+             StateId parent,
+             const Push &move);
+  void GetSolution(std::vector<Push> &path);
+
+  Board &board;
+  Board backwardBoard;
+  SimpleDeadlockDetector simpleDeadlockDetector;
+  FreezeDeadlockDetector freezeDeadlockDetector;
+  Frontier forward;
+  Frontier backward;
+  SolverOptions options;
+  std::vector<Push> noPushes;
+  int statesVisited;
+  int solutionPushes;
+
+  // The cheapest meeting point: the state in "meetingFrontier" from which
+  // "meetingMove" led to state "meetingOpposite" of the opposite search.
+  Frontier *meetingFrontier;
+  StateId meetingParent;
+  uint16_t meetingMove;
+  StateId meetingOpposite;
+};
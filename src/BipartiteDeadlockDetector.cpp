@@ -0,0 +1,82 @@
+#include "BipartiteDeadlockDetector.h"
+
+#include <algorithm>
+#include <cassert>
+
+BipartiteDeadlockDetector::BipartiteDeadlockDetector(
+    const Board &board,
+    const DistanceTable &distanceTable)
+    : reachableGoals(board.Size()),
+      boxGoals(board.Boxes().size(), -1),
+      goalBoxes(distanceTable.TargetCount(), -1),
+      visited(distanceTable.TargetCount()) {
+  for (Position p = 0; p < board.Size(); p++) {
+    for (int goal = 0; goal < distanceTable.TargetCount(); goal++) {
+      if (!board.HasWall(p) && distanceTable.CanReach(p, goal)) {
+        reachableGoals[p].push_back(goal);
+      }
+    }
+  }
+}
+
+bool BipartiteDeadlockDetector::IsDeadlock(const std::vector<Position> &boxes) {
+  assert(boxes.size() == boxGoals.size());
+
+  std::fill(boxGoals.begin(), boxGoals.end(), -1);
+  std::fill(goalBoxes.begin(), goalBoxes.end(), -1);
+  bool deadlock = false;
+  for (int box = 0; box < boxes.size(); box++) {
+    visited.Clear();
+    deadlock = !Augment(boxes, box, boxGoals, goalBoxes) || deadlock;
+  }
+  return deadlock;
+}
+
+bool BipartiteDeadlockDetector::IsDeadlock(const std::vector<Position> &boxes,
+                                           int movedBox) {
+  assert(boxes.size() == boxGoals.size());
+
+  // N.B., the moved box usually keeps its goal. Otherwise it is re-matched
+  // along an augmenting path, which leaves the other boxes matched.
+  int goal = boxGoals[movedBox];
+  if (goal != -1) {
+    const std::vector<int> &goals = reachableGoals[boxes[movedBox]];
+    if (std::find(goals.begin(), goals.end(), goal) != goals.end()) {
+      return false;
+    }
+  }
+  scratchBoxGoals = boxGoals;
+  scratchGoalBoxes = goalBoxes;
+  if (goal != -1) {
+    scratchBoxGoals[movedBox] = -1;
+    scratchGoalBoxes[goal] = -1;
+  }
+  for (int box = 0; box < boxes.size(); box++) {
+    visited.Clear();
+    if (scratchBoxGoals[box] == -1 &&
+        !Augment(boxes, box, scratchBoxGoals, scratchGoalBoxes)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool BipartiteDeadlockDetector::Augment(const std::vector<Position> &boxes,
+                                        int box,
+                                        std::vector<int> &matchedGoals,
+                                        std::vector<int> &matchedBoxes) {
+  // N.B., goals are visited at most once per augmenting path search.
+  for (int goal : reachableGoals[boxes[box]]) {
+    if (visited.Contains(goal)) {
+      continue;
+    }
+    visited.Insert(goal);
+    if (matchedBoxes[goal] == -1 ||
+        Augment(boxes, matchedBoxes[goal], matchedGoals, matchedBoxes)) {
+      matchedGoals[box] = goal;
+      matchedBoxes[goal] = box;
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include "Board.h"
+#include "DistanceTable.h"
+#include "ScratchSet.h"
+
+// Detects states in which the boxes cannot all be matched to distinct goals
+// they can reach, e.g., two boxes which can only reach the same goal. Boxes
+// are matched by augmenting paths, and after a push only the pushed box is
+// re-matched, starting from the matching of the state before the push.
+class BipartiteDeadlockDetector {
+public:
+  BipartiteDeadlockDetector(const Board &board,
+                            const DistanceTable &distanceTable);
+
+  // Matches the boxes from scratch, keeping the matching for later calls.
+  bool IsDeadlock(const std::vector<Position> &boxes);
+
+  // Re-checks after a single box has moved, given the boxes as matched by
+  // the last call to IsDeadlock(boxes).
+  bool IsDeadlock(const std::vector<Position> &boxes, int movedBox);
+
+private:
+  bool Augment(const std::vector<Position> &boxes,
+               int box,
+               std::vector<int> &matchedGoals,
+               std::vector<int> &matchedBoxes);
+
+  std::vector<std::vector<int>> reachableGoals;
+  std::vector<int> boxGoals;
+  std::vector<int> goalBoxes;
+  std::vector<int> scratchBoxGoals;
+  std::vector<int> scratchGoalBoxes;
+  ScratchSet visited;
+};
@@ -0,0 +1,137 @@
+#include "BitBoard.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// N.B., AVX2 shifts move four words at a time.
+static const int WORDS_PER_STEP = 4;
+
+BitBoard::BitBoard(const Board &board)
+    : board(board),
+      words(((board.Size() + 63) / 64 + WORDS_PER_STEP - 1) / WORDS_PER_STEP *
+            WORDS_PER_STEP),
+      padding(board.Width() / 64 + 2),
+      interior(NewPlane()),
+      boxes(NewPlane()),
+      open(NewPlane()),
+      reached(NewPlane()),
+      next(NewPlane()),
+      behind(NewPlane()),
+      ahead(NewPlane()),
+      pushable{NewPlane(), NewPlane(), NewPlane(), NewPlane()} {
+  for (Position p = 0; p < board.Size(); p++) {
+    if (board.IsInterior(p)) {
+      interior[padding + p / 64] |= (uint64_t)1 << (p % 64);
+    }
+  }
+}
+
+BitBoard::Plane BitBoard::NewPlane() const {
+  return Plane(padding + words + padding, 0);
+}
+
+void BitBoard::OrShifted(const Plane &src, Plane &dst, int offset) const {
+  // Each destination word combines two source words: the one the shift
+  // starts in and its neighbor the bits carry over from.
+  bool up = offset > 0;
+  int wordShift = std::abs(offset) / 64;
+  int bitShift = std::abs(offset) % 64;
+  const uint64_t *from = &src[padding + (up ? -wordShift : wordShift)];
+  const uint64_t *carry = from + (up ? -1 : 1);
+  uint64_t *to = &dst[padding];
+#ifdef __AVX2__
+  // N.B., AVX2 shifts by 64 or more bits give zero, so no carry is needed
+  // when the shift is a whole number of words.
+  __m128i shift = _mm_cvtsi32_si128(bitShift);
+  __m128i carryShift = _mm_cvtsi32_si128(64 - bitShift);
+  for (int i = 0; i < words; i += WORDS_PER_STEP) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(from + i));
+    __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(carry + i));
+    __m256i shifted =
+        up ? _mm256_or_si256(_mm256_sll_epi64(a, shift),
+                             _mm256_srl_epi64(b, carryShift))
+           : _mm256_or_si256(_mm256_srl_epi64(a, shift),
+                             _mm256_sll_epi64(b, carryShift));
+    __m256i *out = reinterpret_cast<__m256i *>(to + i);
+    _mm256_storeu_si256(out, _mm256_or_si256(_mm256_loadu_si256(out), shifted));
+  }
+#else
+  for (int i = 0; i < words; i++) {
+    if (up) {
+      to[i] |= from[i] << bitShift |
+               (bitShift ? carry[i] >> (64 - bitShift) : 0);
+    } else {
+      to[i] |= from[i] >> bitShift |
+               (bitShift ? carry[i] << (64 - bitShift) : 0);
+    }
+  }
+#endif
+}
+
+Position BitBoard::FindPushes(std::vector<Push> &pushes) {
+  pushes.clear();
+  std::fill(boxes.begin(), boxes.end(), 0);
+  for (Position box : board.Boxes()) {
+    boxes[padding + box / 64] |= (uint64_t)1 << (box % 64);
+  }
+  for (int i = padding; i < padding + words; i++) {
+    open[i] = interior[i] & ~boxes[i];
+  }
+
+  // Grow the reached cells by a step in every direction until they stop
+  // changing.
+  Position player = board.Player();
+  std::fill(reached.begin(), reached.end(), 0);
+  reached[padding + player / 64] = (uint64_t)1 << (player % 64);
+  bool changed = true;
+  while (changed) {
+    next = reached;
+    for (Direction d : ALL_DIRECTIONS) {
+      OrShifted(reached, next, board.MovePosition(0, d));
+    }
+    changed = false;
+    for (int i = padding; i < padding + words; i++) {
+      uint64_t word = next[i] & open[i];
+      changed = changed || word != reached[i];
+      reached[i] = word;
+    }
+  }
+
+  // A box can be pushed if the cell behind it is reached and the cell ahead
+  // of it is open.
+  for (Direction d : ALL_DIRECTIONS) {
+    int offset = board.MovePosition(0, d);
+    std::fill(behind.begin(), behind.end(), 0);
+    std::fill(ahead.begin(), ahead.end(), 0);
+    OrShifted(reached, behind, offset);
+    OrShifted(open, ahead, -offset);
+    Plane &plane = pushable[(int)d];
+    for (int i = padding; i < padding + words; i++) {
+      plane[i] = boxes[i] & behind[i] & ahead[i];
+    }
+  }
+  for (int i = padding; i < padding + words; i++) {
+    uint64_t any = pushable[0][i] | pushable[1][i] | pushable[2][i] |
+                   pushable[3][i];
+    for (; any; any &= any - 1) {
+      Position box = (i - padding) * 64 + __builtin_ctzll(any);
+      for (Direction d : ALL_DIRECTIONS) {
+        if (Test(pushable[(int)d], box)) {
+          pushes.emplace_back(box, d);
+        }
+      }
+    }
+  }
+
+  for (int i = padding; i < padding + words; i++) {
+    if (reached[i]) {
+      return (i - padding) * 64 + __builtin_ctzll(reached[i]);
+    }
+  }
+  return player;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Board.h"
+
+// Bit planes over the board's cells, in row-major order, for finding the
+// player's reachable cells and legal pushes with word-parallel flood fills
+// instead of a per-cell DFS. Moving a plane one cell in a direction is a
+// shift by one bit (or one row of bits), and uses AVX2 where the compiler
+// targets it.
+//
+// N.B., planes are padded with zero words on either side, so that shifts by
+// a row never index out of bounds. Cells outside the player's interior are
+// never set, so bits shifted across the ends of rows are masked off.
+class BitBoard {
+public:
+  BitBoard(const Board &board);
+
+  // Floods the cells the player can reach given the board's boxes, and finds
+  // the legal pushes from them. Returns the normalized player position.
+  Position FindPushes(std::vector<Push> &pushes);
+
+  bool IsReached(Position p) const { return Test(reached, p); }
+  bool IsPushable(Position box, Direction d) const {
+    return Test(pushable[(int)d], box);
+  }
+
+private:
+  typedef std::vector<uint64_t> Plane;
+
+  Plane NewPlane() const;
+  bool Test(const Plane &plane, Position p) const {
+    return plane[padding + p / 64] >> (p % 64) & 1;
+  }
+  void OrShifted(const Plane &src, Plane &dst, int offset) const;
+
+  const Board &board;
+  int words;
+  int padding;
+  Plane interior;
+  Plane boxes;
+  Plane open;
+  Plane reached;
+  Plane next;
+  Plane behind;
+  Plane ahead;
+  Plane pushable[4];
+};
@@ -10,6 +10,7 @@
 #include <random>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 using namespace std::string_literals;
@@ -58,6 +59,15 @@ Board::Board(int width,
     }
   }
 
+  // Index the open cells densely.
+  cellIndices.assign(size, -1);
+  for (Position p = 0; p < size; p++) {
+    if (!wallArray[p]) {
+      cellIndices[p] = cells.size();
+      cells.push_back(p);
+    }
+  }
+
   // Compute hash tables.
   std::mt19937_64 rnd(0xdeadbeef);
   for (int i = 0; i < boxArrayHashTable.size(); ++i) {
@@ -139,7 +149,81 @@ Board Board::ParseFromText(std::istream &is) {
   // N.B., shrink vector to min size since it should never grow.
   boxes.shrink_to_fit();
 
-  return Board(width, height, player, wallArray, boxes, goals);
+  Board board(width, height, player, wallArray, boxes, goals);
+  board.Normalize();
+  return board;
+}
+
+void Board::Normalize() {
+  // Find the cells the player can reach, ignoring boxes.
+  std::vector<bool> interior(size, false);
+  std::vector<Position> stack = {player};
+  interior[player] = true;
+  while (!stack.empty()) {
+    Position p = stack.back();
+    stack.pop_back();
+    int x = PositionX(p);
+    int y = PositionY(p);
+    for (Direction d : ALL_DIRECTIONS) {
+      Position p2 = MovePosition(p, d);
+      if ((d == Direction::LEFT && x == 0) ||
+          (d == Direction::RIGHT && x == width - 1) ||
+          (d == Direction::UP && y == 0) ||
+          (d == Direction::DOWN && y == height - 1) || interior[p2] ||
+          wallArray[p2]) {
+        continue;
+      }
+      interior[p2] = true;
+      stack.push_back(p2);
+    }
+  }
+
+  // N.B., boxes and goals are kept wherever they are, so that the level is
+  // unchanged.
+  std::vector<bool> kept = interior;
+  for (Position p : boxes) {
+    kept[p] = true;
+  }
+  for (Position p : goals) {
+    kept[p] = true;
+  }
+
+  // Crop to the kept cells plus a border, and wall off everything else.
+  int minX = width, minY = height, maxX = -1, maxY = -1;
+  for (Position p = 0; p < size; p++) {
+    if (kept[p]) {
+      minX = std::min(minX, PositionX(p));
+      minY = std::min(minY, PositionY(p));
+      maxX = std::max(maxX, PositionX(p));
+      maxY = std::max(maxY, PositionY(p));
+    }
+  }
+  int newWidth = maxX - minX + 3;
+  int newHeight = maxY - minY + 3;
+  auto remap = [&](Position p) {
+    return (PositionY(p) - minY + 1) * newWidth + (PositionX(p) - minX + 1);
+  };
+  std::vector<bool> newWallArray(newWidth * newHeight, true);
+  std::vector<bool> newInteriorArray(newWidth * newHeight, false);
+  for (Position p = 0; p < size; p++) {
+    if (kept[p]) {
+      newWallArray[remap(p)] = false;
+    }
+    if (interior[p]) {
+      newInteriorArray[remap(p)] = true;
+    }
+  }
+  std::vector<Position> newBoxes;
+  for (Position p : boxes) {
+    newBoxes.push_back(remap(p));
+  }
+  std::vector<Position> newGoals;
+  for (Position p : goals) {
+    newGoals.push_back(remap(p));
+  }
+  *this = Board(newWidth, newHeight, remap(player), newWallArray, newBoxes,
+                newGoals);
+  interiorArray = std::move(newInteriorArray);
 }
 
 void Board::DumpToText(std::ostream &os) const {
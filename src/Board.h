@@ -30,6 +30,17 @@ public:
   bool HasGoal(Position p) const { return goalArray[p] != -1; }
   bool HasWall(Position p) const { return wallArray[p]; }
   bool HasBox(Position p) const { return boxArray[p] != -1; }
+  int BoxIndex(Position p) const { return boxArray[p]; }
+
+  // Whether the player can reach the cell, ignoring boxes. N.B., this is
+  // every open cell except boxes or goals walled in on their own.
+  bool IsInterior(Position p) const { return interiorArray[p]; }
+
+  // Dense index over the open cells, or -1 for walls. N.B., boards are
+  // normalized when parsed, so every open cell is part of the level.
+  int CellCount() const { return cells.size(); }
+  int CellIndex(Position p) const { return cellIndices[p]; }
+  Position Cell(int index) const { return cells[index]; }
 
   Position Player() const { return player; }
   const std::vector<Position> &Boxes() const { return boxes; }
@@ -78,6 +89,9 @@ private:
         const std::vector<Position> &boxes,
         const std::vector<Position> &goalArray);
 
+  // Walls off the cells outside the player's reach (except those holding
+  // boxes or goals), crops the board to the remaining cells and records the
+  // player's reach as the interior.
   void Normalize();
   uint64_t ComputeHash() const;
 
@@ -88,6 +102,9 @@ private:
   std::vector<int> boxArray;
   std::vector<int> goalArray;
   std::vector<bool> wallArray;
+  std::vector<bool> interiorArray;
+  std::vector<int> cellIndices;
+  std::vector<Position> cells;
   std::vector<uint64_t> boxArrayHashTable;
   std::vector<uint64_t> playerArrayHashTable;
   int goalsCompleted;
@@ -0,0 +1,123 @@
+#include "BucketQueue.h"
+
+#include <cassert>
+#include <cstdlib>
+
+BucketQueue::BucketQueue(TieBreak tieBreak)
+    : tieBreak(tieBreak), minFValue(0), size(0) {}
+
+int BucketQueue::Rank(int fValue, int gValue, int hValue) const {
+  switch (tieBreak) {
+  case TieBreak::DEEPEST_G:
+    return fValue - gValue;
+  case TieBreak::LOWEST_H:
+    return hValue;
+  case TieBreak::LIFO:
+    return 0;
+  }
+  std::abort();
+}
+
+void BucketQueue::Push(StateId id, int fValue, int gValue, int hValue) {
+  assert(fValue >= 0 && fValue >= gValue);
+  int rank = Rank(fValue, gValue, hValue);
+  if (fValue >= levels.size()) {
+    levels.resize(fValue + 1);
+  }
+  Level &level = levels[fValue];
+  if (level.ranks.empty()) {
+    level.baseRank = rank;
+  } else if (rank < level.baseRank) {
+    level.ranks.insert(level.ranks.begin(), level.baseRank - rank,
+                       std::vector<StateId>());
+    level.minRank += level.baseRank - rank;
+    level.baseRank = rank;
+  }
+  int index = rank - level.baseRank;
+  if (index >= level.ranks.size()) {
+    level.ranks.resize(index + 1);
+  }
+  std::vector<StateId> &bucket = level.ranks[index];
+  if (id >= locations.size()) {
+    locations.resize(id + 1);
+  }
+  locations[id] = {(uint32_t)bucket.size(), (uint16_t)fValue, (uint16_t)rank};
+  bucket.push_back(id);
+
+  // Update cursors.
+  if (size == 0 || fValue < minFValue) {
+    minFValue = fValue;
+  }
+  if (index < level.minRank) {
+    level.minRank = index;
+  }
+  size++;
+}
+
+void BucketQueue::Update(StateId id, int fValue, int gValue, int hValue) {
+  // Remove the state from its current bucket.
+  Location location = locations[id];
+  Level &level = levels[location.fValue];
+  std::vector<StateId> &bucket = level.ranks[location.rank - level.baseRank];
+  assert(bucket[location.index] == id);
+  bucket[location.index] = bucket.back();
+  locations[bucket.back()].index = location.index;
+  bucket.pop_back();
+  size--;
+
+  Push(id, fValue, gValue, hValue);
+}
+
+StateId BucketQueue::Pop() {
+  assert(size > 0);
+  for (;; minFValue++) {
+    Level &level = levels[minFValue];
+    for (; level.minRank < level.ranks.size(); level.minRank++) {
+      std::vector<StateId> &bucket = level.ranks[level.minRank];
+      if (!bucket.empty()) {
+        StateId id = bucket.back();
+        bucket.pop_back();
+        size--;
+        return id;
+      }
+    }
+
+    // N.B., release drained levels so their buckets don't pin memory.
+    level.ranks.clear();
+    level.minRank = 0;
+  }
+}
+
+void BucketQueue::Evict(size_t count, std::vector<StateId> &evicted) {
+  while (count > 0 && size > 0) {
+    Level &level = levels.back();
+    if (level.ranks.empty()) {
+      levels.pop_back();
+      continue;
+    }
+    std::vector<StateId> &bucket = level.ranks.back();
+    for (; count > 0 && !bucket.empty(); count--) {
+      evicted.push_back(bucket.back());
+      bucket.pop_back();
+      size--;
+    }
+    if (bucket.empty()) {
+      level.ranks.pop_back();
+      if (level.minRank > level.ranks.size()) {
+        level.minRank = level.ranks.size();
+      }
+    }
+  }
+}
+
+size_t BucketQueue::MemoryUsage() const {
+  size_t result = levels.capacity() * sizeof(Level) +
+                  locations.capacity() * sizeof(Location);
+  for (const Level &level : levels) {
+    result += level.ranks.capacity() * sizeof(std::vector<StateId>);
+    for (const std::vector<StateId> &bucket : level.ranks) {
+      result += bucket.capacity() * sizeof(StateId);
+    }
+  }
+  return result;
+}
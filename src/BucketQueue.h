@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "OpenList.h"
+
+// Two-level bucket priority queue over small non-negative integer f-values.
+// States are bucketed first by f-value and then by a tie-break rank, giving
+// O(1) push and update and amortized O(1) pop. Within a rank bucket states
+// are LIFO.
+//
+// N.B., each level's rank buckets start at the lowest rank pushed to it, so
+// that levels holding only large ranks stay small.
+class BucketQueue : public OpenList {
+public:
+  BucketQueue(TieBreak tieBreak);
+
+  void Push(StateId id, int fValue, int gValue, int hValue) override;
+  void Update(StateId id, int fValue, int gValue, int hValue) override;
+  StateId Pop() override;
+  void Evict(size_t count, std::vector<StateId> &evicted) override;
+
+  bool Empty() const override { return size == 0; }
+  size_t Size() const override { return size; }
+  size_t MemoryUsage() const override;
+
+private:
+  struct Level {
+    std::vector<std::vector<StateId>> ranks;
+    int baseRank = 0;
+    int minRank = 0;
+  };
+
+  struct Location {
+    uint32_t index;
+    uint16_t fValue;
+    uint16_t rank;
+  };
+
+  int Rank(int fValue, int gValue, int hValue) const;
+
+  TieBreak tieBreak;
+  std::vector<Level> levels;
+  std::vector<Location> locations;
+  int minFValue;
+  size_t size;
+};
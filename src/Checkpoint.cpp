@@ -0,0 +1,167 @@
+#include "Checkpoint.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <csignal>
+#include <stdexcept>
+
+using namespace std::string_literals;
+
+static const char MAGIC[8] = {'S', 'O', 'K', 'O', 'C', 'K', 'P', 'T'};
+static const uint64_t VERSION = 1;
+static const uint64_t PAGE_SIZE = 4096;
+static const size_t IO_BUFFER_SIZE = 1 << 20;
+
+struct CheckpointHeader {
+  char magic[8];
+  uint64_t version;
+  uint64_t fingerprint;
+};
+
+struct SectionHeader {
+  uint64_t count;
+  uint64_t elementSize;
+};
+
+CheckpointWriter::CheckpointWriter(const std::string &path,
+                                   uint64_t fingerprint)
+    : path(path), tempPath(path + ".tmp"), offset(0) {
+  file = fopen(tempPath.c_str(), "wb");
+  if (!file) {
+    throw std::runtime_error("cannot write checkpoint: "s + tempPath);
+  }
+  setvbuf(file, nullptr, _IOFBF, IO_BUFFER_SIZE);
+
+  CheckpointHeader header = {};
+  std::copy(MAGIC, MAGIC + sizeof(MAGIC), header.magic);
+  header.version = VERSION;
+  header.fingerprint = fingerprint;
+  WriteBytes(&header, sizeof(header));
+  PadToPage();
+}
+
+CheckpointWriter::~CheckpointWriter() {
+  if (file) {
+    fclose(file);
+    remove(tempPath.c_str());
+  }
+}
+
+void CheckpointWriter::WriteSection(const void *data,
+                                    uint64_t count,
+                                    uint64_t elementSize) {
+  SectionHeader header = {count, elementSize};
+  WriteBytes(&header, sizeof(header));
+  PadToPage();
+  WriteBytes(data, count * elementSize);
+  PadToPage();
+}
+
+void CheckpointWriter::WriteBytes(const void *data, size_t bytes) {
+  // N.B., empty sections may have no data pointer at all.
+  if (bytes > 0 && fwrite(data, 1, bytes, file) != bytes) {
+    throw std::runtime_error("error writing checkpoint: "s + tempPath);
+  }
+  offset += bytes;
+}
+
+void CheckpointWriter::PadToPage() {
+  static const char zeros[PAGE_SIZE] = {};
+  WriteBytes(zeros, (PAGE_SIZE - offset % PAGE_SIZE) % PAGE_SIZE);
+}
+
+void CheckpointWriter::Commit() {
+  if (fflush(file) != 0 || fsync(fileno(file)) != 0) {
+    throw std::runtime_error("error writing checkpoint: "s + tempPath);
+  }
+  fclose(file);
+  file = nullptr;
+  if (rename(tempPath.c_str(), path.c_str()) != 0) {
+    throw std::runtime_error("error writing checkpoint: "s + path);
+  }
+}
+
+CheckpointReader::CheckpointReader(const std::string &path,
+                                   uint64_t fingerprint)
+    : path(path), offset(0) {
+  file = fopen(path.c_str(), "rb");
+  if (!file) {
+    throw std::runtime_error("cannot read checkpoint: "s + path);
+  }
+  setvbuf(file, nullptr, _IOFBF, IO_BUFFER_SIZE);
+
+  CheckpointHeader header;
+  ReadBytes(&header, sizeof(header));
+  if (!std::equal(MAGIC, MAGIC + sizeof(MAGIC), header.magic) ||
+      header.version != VERSION) {
+    throw std::runtime_error("bad checkpoint: "s + path);
+  }
+  if (header.fingerprint != fingerprint) {
+    throw std::runtime_error(
+        "checkpoint is for a different level or search settings: "s + path);
+  }
+  SkipToPage();
+}
+
+CheckpointReader::~CheckpointReader() { fclose(file); }
+
+uint64_t CheckpointReader::ReadSectionHeader(uint64_t elementSize) {
+  SectionHeader header;
+  ReadBytes(&header, sizeof(header));
+  if (header.elementSize != elementSize) {
+    throw std::runtime_error("bad checkpoint: "s + path);
+  }
+  SkipToPage();
+  return header.count;
+}
+
+void CheckpointReader::ReadBytes(void *data, size_t bytes) {
+  if (bytes > 0 && fread(data, 1, bytes, file) != bytes) {
+    throw std::runtime_error("truncated checkpoint: "s + path);
+  }
+  offset += bytes;
+}
+
+void CheckpointReader::SkipToPage() {
+  uint64_t padding = (PAGE_SIZE - offset % PAGE_SIZE) % PAGE_SIZE;
+  if (fseek(file, padding, SEEK_CUR) != 0) {
+    throw std::runtime_error("truncated checkpoint: "s + path);
+  }
+  offset += padding;
+}
+
+uint64_t ComputeFingerprint(const Board &board) {
+  return ComputeFingerprint(board, {});
+}
+
+uint64_t ComputeFingerprint(const Board &board,
+                            const std::vector<uint64_t> &settings) {
+  // N.B., FNV-1a over the layout, then the initial state, then the settings.
+  uint64_t result = 0xcbf29ce484222325;
+  auto mix = [&](uint64_t value) {
+    result ^= value;
+    result *= 0x100000001b3;
+  };
+  mix(board.Width());
+  mix(board.Height());
+  for (Position p = 0; p < board.Size(); p++) {
+    mix(board.HasWall(p) * 2 + board.HasGoal(p));
+  }
+  mix(board.Player());
+  for (Position p : board.Boxes()) {
+    mix(p);
+  }
+  for (uint64_t setting : settings) {
+    mix(setting);
+  }
+  return result;
+}
+
+static volatile std::sig_atomic_t terminationRequested = 0;
+
+static void HandleTermination(int) { terminationRequested = 1; }
+
+void InstallTerminationHandler() { std::signal(SIGTERM, HandleTermination); }
+
+bool TerminationRequested() { return terminationRequested != 0; }
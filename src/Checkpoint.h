@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Board.h"
+
+// Search checkpoints are binary files consisting of a header page followed by
+// a sequence of sections. Each section holds a raw array which starts on a
+// page boundary, so that checkpoints are written and read with large
+// sequential I/O and may equally be memory-mapped.
+//
+// Checkpoints are written to a temporary file which is renamed over the
+// destination once complete, so that an interrupted write never clobbers the
+// previous checkpoint.
+class CheckpointWriter {
+public:
+  CheckpointWriter(const std::string &path, uint64_t fingerprint);
+  ~CheckpointWriter();
+
+  template <typename T> void Write(const std::vector<T> &values) {
+    WriteSection(values.data(), values.size(), sizeof(T));
+  }
+
+  // Makes the checkpoint durable and moves it into place.
+  void Commit();
+
+private:
+  void WriteSection(const void *data, uint64_t count, uint64_t elementSize);
+  void WriteBytes(const void *data, size_t bytes);
+  void PadToPage();
+
+  std::string path;
+  std::string tempPath;
+  FILE *file;
+  uint64_t offset;
+};
+
+class CheckpointReader {
+public:
+  CheckpointReader(const std::string &path, uint64_t fingerprint);
+  ~CheckpointReader();
+
+  template <typename T> void Read(std::vector<T> &values) {
+    values.resize(ReadSectionHeader(sizeof(T)));
+    ReadBytes(values.data(), values.size() * sizeof(T));
+    SkipToPage();
+  }
+
+private:
+  uint64_t ReadSectionHeader(uint64_t elementSize);
+  void ReadBytes(void *data, size_t bytes);
+  void SkipToPage();
+
+  std::string path;
+  FILE *file;
+  uint64_t offset;
+};
+
+// Identifies a level (its layout and initial state), so that checkpoints are
+// only ever resumed against the level they were taken from.
+uint64_t ComputeFingerprint(const Board &board);
+
+// Identifies a level together with the search settings which shape the states
+// stored for it, so that checkpoints are never resumed with incompatible
+// settings.
+uint64_t ComputeFingerprint(const Board &board,
+                            const std::vector<uint64_t> &settings);
+
+// Installs a SIGTERM handler, after which TerminationRequested() reports
+// whether the process has been asked to stop.
+void InstallTerminationHandler();
+bool TerminationRequested();
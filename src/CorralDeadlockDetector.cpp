@@ -0,0 +1,136 @@
+#include "CorralDeadlockDetector.h"
+
+#include <algorithm>
+#include <utility>
+
+// Maximum number of states explored by a corral search before giving up.
+static const size_t SEARCH_LIMIT = 1024;
+
+// Maximum number of cached results, beyond which the cache is cleared.
+static const size_t CACHE_LIMIT = 1 << 16;
+
+// Approximate size of a cache entry, excluding its key's positions: the tree
+// node's links and color, and the entry itself.
+static const size_t CACHE_ENTRY_BYTES =
+    4 * sizeof(void *) + sizeof(std::pair<std::vector<Position>, bool>);
+
+CorralDeadlockDetector::CorralDeadlockDetector(
+    const Board &board,
+    const SimpleDeadlockDetector &simpleDeadlockDetector)
+    : board(board),
+      simpleDeadlockDetector(simpleDeadlockDetector),
+      cacheBytes(0),
+      occupied(board.Size(), false),
+      reached(board.Size()) {}
+
+bool CorralDeadlockDetector::IsDeadlock(
+    const std::vector<Position> &corralCells,
+    const std::vector<Position> &corralBoxes) {
+  SubState initial = {board.Player()};
+  initial.insert(initial.end(), corralBoxes.begin(), corralBoxes.end());
+  std::sort(initial.begin() + 1, initial.end());
+  initial[0] = Reach(initial);
+
+  // N.B., the corral is the region of the first cell fenced in by walls and
+  // the corral's boxes, so the first cell identifies it.
+  SubState key = initial;
+  key.push_back(*std::min_element(corralCells.begin(), corralCells.end()));
+  auto it = cache.find(key);
+  if (it != cache.end()) {
+    return it->second;
+  }
+
+  cells = corralCells;
+  visited = {initial};
+  queue = {initial};
+  bool deadlock = true;
+  for (size_t head = 0; head < queue.size(); head++) {
+    SubState state = queue[head];
+    if (IsResolved(state) || queue.size() > SEARCH_LIMIT) {
+      deadlock = false;
+      break;
+    }
+
+    // N.B., collect pushes first, as Reach() on children clobbers the
+    // parent's reachable cells.
+    Reach(state);
+    pushes.clear();
+    for (int i = 1; i < state.size(); i++) {
+      for (Direction d : ALL_DIRECTIONS) {
+        Position to = board.MovePosition(state[i], d);
+        if (reached.Contains(board.UnmovePosition(state[i], d)) &&
+            !board.HasWall(to) && !simpleDeadlockDetector.IsDeadlock(to) &&
+            !std::binary_search(state.begin() + 1, state.end(), to)) {
+          pushes.push_back(Push(state[i], d));
+        }
+      }
+    }
+    for (const Push &push : pushes) {
+      SubState child = state;
+      *std::find(child.begin() + 1, child.end(), push.Box()) =
+          board.MovePosition(push.Box(), push.Direction());
+      child[0] = push.Box();
+      std::sort(child.begin() + 1, child.end());
+      child[0] = Reach(child);
+      if (visited.insert(child).second) {
+        queue.push_back(child);
+      }
+    }
+  }
+  if (cache.size() >= CACHE_LIMIT) {
+    ClearCache();
+  }
+  cache[key] = deadlock;
+  cacheBytes += CACHE_ENTRY_BYTES + key.capacity() * sizeof(Position);
+  return deadlock;
+}
+
+void CorralDeadlockDetector::ClearCache() {
+  cache.clear();
+  cacheBytes = 0;
+}
+
+bool CorralDeadlockDetector::IsResolved(const SubState &state) {
+  bool solved = true;
+  for (int i = 1; i < state.size(); i++) {
+    solved = solved && board.HasGoal(state[i]);
+  }
+  if (solved) {
+    return true;
+  }
+
+  // The corral is open once the player can reach into it.
+  Reach(state);
+  for (Position p : cells) {
+    if (reached.Contains(p)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Position CorralDeadlockDetector::Reach(const SubState &state) {
+  for (int i = 1; i < state.size(); i++) {
+    occupied[state[i]] = true;
+  }
+  reached.Clear();
+  Position result = state[0];
+  stack.assign(1, state[0]);
+  reached.Insert(state[0]);
+  while (!stack.empty()) {
+    Position p = stack.back();
+    stack.pop_back();
+    result = std::min(result, p);
+    for (Direction d : ALL_DIRECTIONS) {
+      Position p2 = board.MovePosition(p, d);
+      if (!reached.Contains(p2) && !board.HasWall(p2) && !occupied[p2]) {
+        reached.Insert(p2);
+        stack.push_back(p2);
+      }
+    }
+  }
+  for (int i = 1; i < state.size(); i++) {
+    occupied[state[i]] = false;
+  }
+  return result;
+}
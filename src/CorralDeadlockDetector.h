@@ -0,0 +1,48 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "Board.h"
+#include "ScratchSet.h"
+#include "SimpleDeadlockDetector.h"
+
+// Detects PI-corrals which can never be resolved. A bounded search pushes
+// only the corral's boxes, with all other boxes removed, looking for a way to
+// either open the corral to the player or get the corral's boxes onto goals.
+// Any solution must do one or the other, so if the search is exhausted the
+// state is deadlocked. Results are cached by corral, up to a limit.
+class CorralDeadlockDetector {
+public:
+  CorralDeadlockDetector(const Board &board,
+                         const SimpleDeadlockDetector &simpleDeadlockDetector);
+
+  // Checks the corral made up of the given cells, fenced in by the given
+  // boxes, with the player outside.
+  bool IsDeadlock(const std::vector<Position> &corralCells,
+                  const std::vector<Position> &corralBoxes);
+
+  // Drops cached results, which are recomputed on demand.
+  void ClearCache();
+  size_t MemoryUsage() const { return cacheBytes; }
+
+private:
+  // Search state: the normalized player followed by the sorted boxes.
+  typedef std::vector<Position> SubState;
+
+  bool IsResolved(const SubState &state);
+  Position Reach(const SubState &state);
+
+  const Board &board;
+  const SimpleDeadlockDetector &simpleDeadlockDetector;
+  std::map<SubState, bool> cache;
+  size_t cacheBytes;
+  std::vector<Position> cells;
+  std::set<SubState> visited;
+  std::vector<SubState> queue;
+  std::vector<Push> pushes;
+  std::vector<Position> stack;
+  std::vector<bool> occupied;
+  ScratchSet reached;
+};
@@ -0,0 +1,257 @@
+#include "DeadlockDatabase.h"
+
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+
+// Maximum number of states explored by a sub-search before giving up.
+static const size_t SEARCH_LIMIT = 512;
+
+// Boxes pushed further than this from every other box (in both coordinates)
+// are assumed to be free, and are dropped from the sub-search.
+static const int ESCAPE_DISTANCE = 1;
+
+// Maximum number of remembered solvable clusters, beyond which they are
+// forgotten.
+static const size_t MAX_SOLVABLE_CLUSTERS = 1 << 16;
+
+DeadlockDatabase::DeadlockDatabase(
+    const Board &board,
+    const SimpleDeadlockDetector &simpleDeadlockDetector)
+    : board(board),
+      simpleDeadlockDetector(simpleDeadlockDetector),
+      regionWords((board.Size() + 63) / 64),
+      patternOffsets{0},
+      patternsByCell(board.Size()),
+      occupied(board.Size(), false),
+      reached(board.Size()) {}
+
+bool DeadlockDatabase::IsDeadlock(Position box) {
+  for (uint32_t pattern : patternsByCell[box]) {
+    if (Matches(pattern)) {
+      return true;
+    }
+  }
+
+  // Only clusters of boxes are searched; lone boxes are left to the simple
+  // deadlock detector and the distance table.
+  FindCluster(box);
+  if (cluster.size() < 2) {
+    return false;
+  }
+  SubState initial;
+  initial.fill(-1);
+  initial[0] = board.Player();
+  std::copy(cluster.begin(), cluster.end(),
+            initial.end() - cluster.size());
+  initial[0] = Reach(initial);
+
+  // N.B., sub-searches which fail to prove a deadlock are remembered, so
+  // that they are not repeated.
+  uint64_t hash = 0xcbf29ce484222325;
+  for (Position p : initial) {
+    hash = (hash ^ (uint64_t)(p + 1)) * 0x100000001b3;
+  }
+  if (solvableClusters.count(hash)) {
+    return false;
+  }
+  if (!Search(initial)) {
+    if (solvableClusters.size() >= MAX_SOLVABLE_CLUSTERS) {
+      solvableClusters.clear();
+    }
+    solvableClusters.insert(hash);
+    return false;
+  }
+  Learn(initial);
+  return true;
+}
+
+bool DeadlockDatabase::Matches(uint32_t pattern) const {
+  for (uint32_t i = patternOffsets[pattern]; i < patternOffsets[pattern + 1];
+       i++) {
+    if (!board.HasBox(patternBoxes[i])) {
+      return false;
+    }
+  }
+  Position player = board.Player();
+  return patternRegions[(size_t)pattern * regionWords + player / 64] >>
+             (player % 64) &
+         1;
+}
+
+void DeadlockDatabase::FindCluster(Position box) {
+  // Collect the boxes touching the pushed box, including diagonally, and
+  // the boxes touching those, nearest first.
+  cluster.assign(1, box);
+  for (int head = 0;
+       head < cluster.size() && cluster.size() < MAX_PATTERN_BOXES; head++) {
+    for (int dy = -1; dy <= 1; dy++) {
+      for (int dx = -1; dx <= 1; dx++) {
+        Position p = cluster[head] + dy * board.Width() + dx;
+        if (p >= 0 && p < board.Size() && board.HasBox(p) &&
+            std::find(cluster.begin(), cluster.end(), p) == cluster.end() &&
+            cluster.size() < MAX_PATTERN_BOXES) {
+          cluster.push_back(p);
+        }
+      }
+    }
+  }
+  std::sort(cluster.begin(), cluster.end());
+}
+
+bool DeadlockDatabase::Search(const SubState &initial) {
+  // Breadth-first search for a way to get the cluster's boxes onto goals
+  // or out of the way. N.B., dropping escaped boxes only makes the
+  // sub-problem easier, so exhausting it still proves a deadlock.
+  std::set<SubState> visited = {initial};
+  std::vector<SubState> queue = {initial};
+  for (size_t head = 0; head < queue.size(); head++) {
+    SubState state = queue[head];
+    bool solved = true;
+    for (int i = 1; i <= MAX_PATTERN_BOXES; i++) {
+      solved = solved && (state[i] == -1 || board.HasGoal(state[i]));
+    }
+    if (solved) {
+      return false;
+    }
+    if (queue.size() > SEARCH_LIMIT) {
+      return false;
+    }
+
+    // N.B., collect pushes first, as Reach() on children clobbers the
+    // parent's reachable cells.
+    Reach(state);
+    pushes.clear();
+    for (int i = 1; i <= MAX_PATTERN_BOXES; i++) {
+      Position box = state[i];
+      if (box == -1) {
+        continue;
+      }
+      for (Direction d : ALL_DIRECTIONS) {
+        Position to = board.MovePosition(box, d);
+        if (reached.Contains(board.UnmovePosition(box, d)) &&
+            !board.HasWall(to) && !simpleDeadlockDetector.IsDeadlock(to) &&
+            std::find(state.begin() + 1, state.end(), to) == state.end()) {
+          pushes.push_back(Push(box, d));
+        }
+      }
+    }
+    for (const Push &push : pushes) {
+      SubState child = state;
+      Position to = board.MovePosition(push.Box(), push.Direction());
+      Position *box = std::find(child.begin() + 1, child.end(), push.Box());
+      *box = to;
+      if (IsEscaped(child, to)) {
+        *box = -1;
+      }
+      child[0] = push.Box();
+      std::sort(child.begin() + 1, child.end());
+      child[0] = Reach(child);
+      if (visited.insert(child).second) {
+        queue.push_back(child);
+      }
+    }
+  }
+  return true;
+}
+
+Position DeadlockDatabase::Reach(const SubState &state) {
+  for (int i = 1; i <= MAX_PATTERN_BOXES; i++) {
+    if (state[i] != -1) {
+      occupied[state[i]] = true;
+    }
+  }
+  reached.Clear();
+  Position result = state[0];
+  stack.assign(1, state[0]);
+  reached.Insert(state[0]);
+  while (!stack.empty()) {
+    Position p = stack.back();
+    stack.pop_back();
+    result = std::min(result, p);
+    for (Direction d : ALL_DIRECTIONS) {
+      Position p2 = board.MovePosition(p, d);
+      if (!reached.Contains(p2) && !board.HasWall(p2) && !occupied[p2]) {
+        reached.Insert(p2);
+        stack.push_back(p2);
+      }
+    }
+  }
+  for (int i = 1; i <= MAX_PATTERN_BOXES; i++) {
+    if (state[i] != -1) {
+      occupied[state[i]] = false;
+    }
+  }
+  return result;
+}
+
+bool DeadlockDatabase::IsEscaped(const SubState &state, Position box) const {
+  for (int i = 1; i <= MAX_PATTERN_BOXES; i++) {
+    if (state[i] != -1 && state[i] != box &&
+        std::abs(board.PositionX(state[i]) - board.PositionX(box)) <=
+            ESCAPE_DISTANCE &&
+        std::abs(board.PositionY(state[i]) - board.PositionY(box)) <=
+            ESCAPE_DISTANCE) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void DeadlockDatabase::Learn(const SubState &initial) {
+  uint32_t pattern = PatternCount();
+  patternBoxes.insert(patternBoxes.end(), cluster.begin(), cluster.end());
+  patternOffsets.push_back(patternBoxes.size());
+  patternRegions.resize(patternRegions.size() + regionWords, 0);
+  Reach(initial);
+  uint64_t *region = &patternRegions[(size_t)pattern * regionWords];
+  for (Position p = 0; p < board.Size(); p++) {
+    if (reached.Contains(p)) {
+      region[p / 64] |= (uint64_t)1 << (p % 64);
+    }
+  }
+  IndexPattern(pattern);
+}
+
+void DeadlockDatabase::IndexPattern(uint32_t pattern) {
+  for (uint32_t i = patternOffsets[pattern]; i < patternOffsets[pattern + 1];
+       i++) {
+    patternsByCell[patternBoxes[i]].push_back(pattern);
+  }
+}
+
+void DeadlockDatabase::Write(CheckpointWriter &writer) const {
+  writer.Write(patternBoxes);
+  writer.Write(patternOffsets);
+  writer.Write(patternRegions);
+}
+
+void DeadlockDatabase::Read(CheckpointReader &reader) {
+  reader.Read(patternBoxes);
+  reader.Read(patternOffsets);
+  reader.Read(patternRegions);
+  if (patternOffsets.empty() || patternOffsets.back() != patternBoxes.size() ||
+      patternRegions.size() != PatternCount() * regionWords) {
+    throw std::runtime_error("bad deadlock database");
+  }
+  for (std::vector<uint32_t> &patterns : patternsByCell) {
+    patterns.clear();
+  }
+  for (uint32_t pattern = 0; pattern < PatternCount(); pattern++) {
+    IndexPattern(pattern);
+  }
+}
+
+size_t DeadlockDatabase::MemoryUsage() const {
+  size_t result = patternBoxes.capacity() * sizeof(Position) +
+                  patternOffsets.capacity() * sizeof(uint32_t) +
+                  patternRegions.capacity() * sizeof(uint64_t);
+  for (const std::vector<uint32_t> &patterns : patternsByCell) {
+    result += patterns.capacity() * sizeof(uint32_t);
+  }
+
+  // N.B., each node of the set holds a link besides its hash.
+  result += solvableClusters.bucket_count() * sizeof(void *) +
+            solvableClusters.size() * (sizeof(void *) + sizeof(uint64_t));
+  return result;
+}
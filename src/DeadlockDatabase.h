@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include "Board.h"
+#include "Checkpoint.h"
+#include "ScratchSet.h"
+#include "SimpleDeadlockDetector.h"
+
+// Deadlock patterns learned during search. When a box is pushed next to
+// other boxes, a small sub-search over just that cluster of boxes (with all
+// other boxes removed) tries to get the cluster onto goals. If it cannot,
+// no state containing the cluster with the player in the same region can be
+// solved either, and the cluster's box cells and player region are recorded
+// as a pattern. Patterns are indexed by box cell, so that each push only
+// checks the patterns involving the pushed box.
+class DeadlockDatabase {
+public:
+  DeadlockDatabase(const Board &board,
+                   const SimpleDeadlockDetector &simpleDeadlockDetector);
+
+  // Checks whether the given box, having just been pushed, is part of a
+  // learned pattern, or of a cluster which a sub-search proves deadlocked.
+  bool IsDeadlock(Position box);
+
+  void Write(CheckpointWriter &writer) const;
+  void Read(CheckpointReader &reader);
+
+  size_t PatternCount() const { return patternOffsets.size() - 1; }
+  size_t MemoryUsage() const;
+
+private:
+  static const int MAX_PATTERN_BOXES = 4;
+
+  // Sub-search state: the normalized player followed by the sorted box
+  // positions, with boxes dropped from the search stored as -1.
+  typedef std::array<Position, MAX_PATTERN_BOXES + 1> SubState;
+
+  bool Matches(uint32_t pattern) const;
+  void FindCluster(Position box);
+  bool Search(const SubState &initial);
+  Position Reach(const SubState &state);
+  bool IsEscaped(const SubState &state, Position box) const;
+  void Learn(const SubState &initial);
+  void IndexPattern(uint32_t pattern);
+
+  const Board &board;
+  const SimpleDeadlockDetector &simpleDeadlockDetector;
+  int regionWords;
+  std::vector<Position> patternBoxes;
+  std::vector<uint32_t> patternOffsets;
+  std::vector<uint64_t> patternRegions;
+  std::vector<std::vector<uint32_t>> patternsByCell;
+  std::unordered_set<uint64_t> solvableClusters;
+  std::vector<Position> cluster;
+  std::vector<Push> pushes;
+  std::vector<Position> stack;
+  std::vector<bool> occupied;
+  ScratchSet reached;
+};
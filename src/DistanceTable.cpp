@@ -1,87 +1,398 @@
 #include "DistanceTable.h"
 
+#include <algorithm>
 #include <cassert>
-#include <deque>
+#include <climits>
+#include <cstdint>
 
-struct State {
-  Position position;
-  int distance;
+// Cost of matching a box to a goal it cannot reach. N.B., this is large enough
+// that any matching using such an edge signals a deadlock, yet small enough
+// that sums over all boxes cannot overflow.
+static const int UNREACHABLE_COST = 1 << 20;
 
-  State(Position position, int distance)
-      : position(position), distance(distance) {}
-};
+DistanceTable::DistanceTable(const Board &board,
+                             Heuristic heuristic,
+                             const PatternDatabase *patternDatabase)
+    : DistanceTable(
+          board, board.Goals(), BoxMove::PUSH, heuristic, patternDatabase) {}
 
-DistanceTable::DistanceTable(const Board &board)
+DistanceTable::DistanceTable(const Board &board,
+                             const std::vector<Position> &targets,
+                             BoxMove move,
+                             Heuristic heuristic,
+                             const PatternDatabase *patternDatabase)
     : board(board),
-      distances(board.Goals().size(),
-                std::vector<int>(board.Width() * board.Height(), -1)),
-      buffer(board.Goals().size()) {
-  std::vector<bool> visited(board.Width() * board.Height());
-  std::deque<State> queue;
-
-  for (int i = 0; i < board.Goals().size(); i++) {
-    // Initialize distance array for goal.
-    std::vector<int> &d = distances[i];
+      heuristic(heuristic),
+      patternDatabase(patternDatabase),
+      distances(targets.size(), std::vector<int>(board.Size(), -1)),
+      buffer(targets.size()),
+      bufferIndices(targets.size()) {
+  FindSideGroups();
 
-    // Clear DFS state.
-    std::fill(visited.begin(), visited.end(), false);
+  // Search backwards from each target over (box, player side) states: pulls
+  // from the target give push distances to it, and vice versa.
+  std::vector<int> sideDistances(board.Size() * 4);
+  std::vector<int> queue;
+  for (int i = 0; i < targets.size(); i++) {
+    std::fill(sideDistances.begin(), sideDistances.end(), -1);
     queue.clear();
+    for (Direction d : ALL_DIRECTIONS) {
+      VisitSides(targets[i], d, 0, sideDistances, queue);
+    }
+
+    for (int head = 0; head < queue.size(); head++) {
+      Position box = queue[head] / 4;
+      Direction side = (Direction)(queue[head] % 4);
+      int distance = sideDistances[queue[head]];
+      Position player = board.MovePosition(box, side);
+      if (move == BoxMove::PUSH) {
+        // Pull the box towards the player.
+        if (board.IsInterior(board.MovePosition(player, side))) {
+          VisitSides(player, side, distance + 1, sideDistances, queue);
+        }
+      } else {
+        // Push the box away from the player.
+        Position to = board.UnmovePosition(box, side);
+        if (board.IsInterior(to)) {
+          VisitSides(to, side, distance + 1, sideDistances, queue);
+        }
+      }
+    }
 
-    // Perform DFS.
-    Position initialPos = board.Goals()[i];
-    queue.emplace_back(State(initialPos, 0));
-    while (!queue.empty()) {
-      State &s = queue.front();
-      queue.pop_front();
-      if (visited[s.position]) {
+    // N.B., the side the player will be on is unknown, so take the minimum.
+    std::vector<int> &d = distances[i];
+    for (int j = 0; j < sideDistances.size(); j++) {
+      if (sideDistances[j] != -1 &&
+          (d[j / 4] == -1 || sideDistances[j] < d[j / 4])) {
+        d[j / 4] = sideDistances[j];
+      }
+    }
+  }
+}
+
+void DistanceTable::FindSideGroups() {
+  // Label the sides of each cell by which parts of the level the player can
+  // reach from them with a box on the cell, ignoring other boxes.
+  sideGroups.assign(board.Size() * 4, -1);
+  std::vector<int> visited(board.Size(), -1);
+  std::vector<Position> stack;
+  int search = 0;
+  for (Position box = 0; box < board.Size(); box++) {
+    if (!board.IsInterior(box)) {
+      continue;
+    }
+    for (Direction d : ALL_DIRECTIONS) {
+      Position start = board.MovePosition(box, d);
+      if (!board.IsInterior(start) ||
+          sideGroups[box * 4 + (int)d] != -1) {
         continue;
       }
-      visited[s.position] = true;
-      d[s.position] = s.distance;
-      for (Direction d : ALL_DIRECTIONS) {
-        Position newPos = board.MovePosition(s.position, d);
-        if (!board.HasWall(newPos)) {
-          queue.emplace_back(State(newPos, s.distance + 1));
+
+      // N.B., stop early once all other sides are reached, which keeps the
+      // search local unless the cell separates the level.
+      int remaining = 0;
+      for (Direction d2 : ALL_DIRECTIONS) {
+        Position p = board.MovePosition(box, d2);
+        remaining +=
+            board.IsInterior(p) && sideGroups[box * 4 + (int)d2] == -1;
+      }
+      search++;
+      visited[box] = search;
+      stack.assign(1, start);
+      visited[start] = search;
+      while (!stack.empty() && remaining > 0) {
+        Position p = stack.back();
+        stack.pop_back();
+        for (Direction d2 : ALL_DIRECTIONS) {
+          if (board.MovePosition(box, d2) == p) {
+            sideGroups[box * 4 + (int)d2] = (int)d;
+            remaining--;
+          }
+        }
+        for (Direction d2 : ALL_DIRECTIONS) {
+          Position p2 = board.MovePosition(p, d2);
+          if (board.IsInterior(p2) && visited[p2] != search) {
+            visited[p2] = search;
+            stack.push_back(p2);
+          }
         }
       }
     }
   }
 }
 
+void DistanceTable::VisitSides(Position box,
+                               Direction side,
+                               int distance,
+                               std::vector<int> &sideDistances,
+                               std::vector<int> &queue) const {
+  // N.B., the player may walk between connected sides for free.
+  int group = sideGroups[box * 4 + (int)side];
+  if (group == -1) {
+    return;
+  }
+  for (Direction d : ALL_DIRECTIONS) {
+    int index = box * 4 + (int)d;
+    if (sideGroups[index] == group && sideDistances[index] == -1) {
+      sideDistances[index] = distance;
+      queue.push_back(index);
+    }
+  }
+}
+
 int DistanceTable::EstimateDistance(const std::vector<Position> &boxes) const {
-  assert(boxes.size() == board.Goals().size());
+  assert(boxes.size() == distances.size());
 
-  buffer.clear();
+  if (heuristic == Heuristic::MATCHING) {
+    return CombineDistance(boxes, FindMatching(boxes, scratch));
+  }
+  ResetGoals();
+  return CombineDistance(boxes, CapDistance(MatchBoxes(boxes, 0, nullptr)));
+}
 
-  // Initialize goal indices.
-  for (int i = 0; i < board.Goals().size(); i++) {
-    buffer.push_back(i);
+int DistanceTable::EstimateDistance(const std::vector<Position> &boxes,
+                                    GoalAssignment &assignment) const {
+  assert(boxes.size() == distances.size());
+
+  if (heuristic == Heuristic::MATCHING) {
+    return CombineDistance(boxes, FindMatching(boxes, assignment));
   }
+  ResetGoals();
+  assignment.goals.resize(boxes.size());
+  assignment.distances.resize(boxes.size());
+  assignment.totalDistance = MatchBoxes(boxes, 0, &assignment);
+  return CombineDistance(boxes, CapDistance(assignment.totalDistance));
+}
 
-  // Loop through boxes and greedily pick nearest goal.
+int DistanceTable::UpdateDistance(const std::vector<Position> &boxes,
+                                  int movedBox,
+                                  const GoalAssignment &assignment) const {
+  assert(boxes.size() == distances.size());
+
+  if (heuristic == Heuristic::MATCHING) {
+    scratch.goals = assignment.goals;
+    scratch.boxPotentials = assignment.boxPotentials;
+    scratch.goalPotentials = assignment.goalPotentials;
+    return CombineDistance(boxes, RepairMatching(boxes, movedBox, scratch));
+  }
+
+  // Replay the matches of the boxes before the moved box, which are
+  // unaffected by the move.
+  ResetGoals();
   int totalDistance = 0;
-  for (int i = 0; i < boxes.size(); i++) {
-    Position box = boxes[i];
-
-    // Find nearest goal to the box.
-    int bestDistance = -1;
-    int bestBufferIndex = -1;
-    for (int j = 0; j < buffer.size(); j++) {
-      int goalIndex = buffer[j];
-      if (bestBufferIndex == -1 || distances[goalIndex][box] < bestDistance) {
-        bestDistance = distances[goalIndex][box];
-        bestBufferIndex = j;
-      }
+  for (int i = 0; i < movedBox; i++) {
+    if (assignment.goals[i] != -1) {
+      RemoveGoal(bufferIndices[assignment.goals[i]]);
     }
-    assert(bestDistance >= 0);
+    totalDistance += assignment.distances[i];
+  }
+
+  // N.B., if the moved box is matched to the same goal as before (or is
+  // still stranded), the goals left for later boxes are unchanged, and so
+  // are their matches.
+  int bestBufferIndex;
+  int bestDistance = FindNearestGoal(boxes[movedBox], bestBufferIndex);
+  int bestGoal = bestBufferIndex != -1 ? buffer[bestBufferIndex] : -1;
+  if (bestGoal == assignment.goals[movedBox]) {
+    return CombineDistance(
+        boxes, CapDistance(assignment.totalDistance -
+                           assignment.distances[movedBox] + bestDistance));
+  }
+
+  return CombineDistance(
+      boxes, CapDistance(totalDistance + MatchBoxes(boxes, movedBox, nullptr)));
+}
+
+int DistanceTable::MatchBoxes(const std::vector<Position> &boxes,
+                              int firstBox,
+                              GoalAssignment *assignment) const {
+  // Loop through boxes and greedily pick nearest goal.
+  int totalDistance = 0;
+  for (int i = firstBox; i < boxes.size(); i++) {
+    int bestBufferIndex;
+    int bestDistance = FindNearestGoal(boxes[i], bestBufferIndex);
 
     // Update total distance.
     totalDistance += bestDistance;
+    if (assignment) {
+      assignment->goals[i] =
+          bestBufferIndex != -1 ? buffer[bestBufferIndex] : -1;
+      assignment->distances[i] = bestDistance;
+    }
 
     // Remove the matched goal from further consideration.
-    buffer[bestBufferIndex] = buffer.back();
-    buffer.pop_back();
+    if (bestBufferIndex != -1) {
+      RemoveGoal(bestBufferIndex);
+    }
   }
 
   return totalDistance;
 }
+
+int DistanceTable::FindNearestGoal(Position box, int &bufferIndex) const {
+  // Find the nearest unmatched goal the box can reach.
+  int bestDistance = -1;
+  bufferIndex = -1;
+  for (int j = 0; j < buffer.size(); j++) {
+    int distance = distances[buffer[j]][box];
+    if (distance != -1 && (bufferIndex == -1 || distance < bestDistance)) {
+      bestDistance = distance;
+      bufferIndex = j;
+    }
+  }
+  if (bufferIndex != -1) {
+    return bestDistance;
+  }
+
+  // N.B., earlier boxes may have taken every goal this box can reach, which
+  // proves nothing as the matching is greedy. The box is then charged for its
+  // nearest goal regardless, leaving deadlocks to be proven by exact matching.
+  // Only a box which can reach no goal at all is deadlocked.
+  for (int goal = 0; goal < distances.size(); goal++) {
+    int distance = distances[goal][box];
+    if (distance != -1 && (bestDistance == -1 || distance < bestDistance)) {
+      bestDistance = distance;
+    }
+  }
+  return bestDistance != -1 ? bestDistance : UNREACHABLE_COST;
+}
+
+void DistanceTable::ResetGoals() const {
+  buffer.clear();
+  for (int i = 0; i < distances.size(); i++) {
+    buffer.push_back(i);
+    bufferIndices[i] = i;
+  }
+}
+
+void DistanceTable::RemoveGoal(int bufferIndex) const {
+  buffer[bufferIndex] = buffer.back();
+  bufferIndices[buffer[bufferIndex]] = bufferIndex;
+  buffer.pop_back();
+}
+
+int DistanceTable::CapDistance(int totalDistance) {
+  // N.B., any estimate is admissible for a deadlocked state.
+  return totalDistance < UNREACHABLE_COST ? totalDistance : DEADLOCK_DISTANCE;
+}
+
+int DistanceTable::CombineDistance(const std::vector<Position> &boxes,
+                                   int distance) const {
+  if (!patternDatabase || distance == DEADLOCK_DISTANCE) {
+    return distance;
+  }
+  int patternDistance = patternDatabase->EstimateDistance(boxes);
+  return patternDistance == -1 ? DEADLOCK_DISTANCE
+                               : std::max(distance, patternDistance);
+}
+
+int DistanceTable::Cost(Position box, int goal) const {
+  int distance = distances[goal][box];
+  return distance >= 0 ? distance : UNREACHABLE_COST;
+}
+
+int DistanceTable::FindMatching(const std::vector<Position> &boxes,
+                                GoalAssignment &assignment) const {
+  // Add boxes one at a time with the Hungarian algorithm, starting from zero
+  // potentials, which are feasible as costs are non-negative.
+  int n = boxes.size();
+  assignment.goals.assign(n, -1);
+  assignment.boxPotentials.assign(n, 0);
+  assignment.goalPotentials.assign(n, 0);
+  goalBoxes.assign(n + 1, -1);
+  for (int i = 0; i < n; i++) {
+    Augment(boxes, i, assignment);
+  }
+  return SumMatching(boxes, assignment);
+}
+
+int DistanceTable::RepairMatching(const std::vector<Position> &boxes,
+                                  int movedBox,
+                                  GoalAssignment &assignment) const {
+  // Unmatch the moved box, and restore dual feasibility for its new costs by
+  // lowering its potential; all other potentials and matches stay valid.
+  int n = boxes.size();
+  goalBoxes.assign(n + 1, -1);
+  for (int i = 0; i < n; i++) {
+    goalBoxes[assignment.goals[i]] = i;
+  }
+  goalBoxes[assignment.goals[movedBox]] = -1;
+  assignment.goals[movedBox] = -1;
+  int potential = INT_MAX;
+  for (int j = 0; j < n; j++) {
+    potential = std::min(potential, Cost(boxes[movedBox], j) -
+                                        assignment.goalPotentials[j]);
+  }
+  assignment.boxPotentials[movedBox] = potential;
+
+  Augment(boxes, movedBox, assignment);
+  return SumMatching(boxes, assignment);
+}
+
+void DistanceTable::Augment(const std::vector<Position> &boxes,
+                            int box,
+                            GoalAssignment &assignment) const {
+  // Grow a shortest augmenting path from the box, Dijkstra-style, over
+  // reduced costs. N.B., goal n is a virtual root matched to the box.
+  int n = boxes.size();
+  std::vector<int> &boxPotentials = assignment.boxPotentials;
+  std::vector<int> &goalPotentials = assignment.goalPotentials;
+  minSlacks.assign(n, INT_MAX);
+  previousGoals.assign(n, n);
+  visited.assign(n + 1, false);
+  goalBoxes[n] = box;
+  int goal = n;
+  do {
+    visited[goal] = true;
+    int i = goalBoxes[goal];
+    int delta = INT_MAX;
+    int nextGoal = -1;
+    for (int j = 0; j < n; j++) {
+      if (visited[j]) {
+        continue;
+      }
+      int slack = Cost(boxes[i], j) - boxPotentials[i] - goalPotentials[j];
+      if (slack < minSlacks[j]) {
+        minSlacks[j] = slack;
+        previousGoals[j] = goal;
+      }
+      if (minSlacks[j] < delta) {
+        delta = minSlacks[j];
+        nextGoal = j;
+      }
+    }
+    for (int j = 0; j <= n; j++) {
+      if (visited[j]) {
+        boxPotentials[goalBoxes[j]] += delta;
+        if (j < n) {
+          goalPotentials[j] -= delta;
+        }
+      } else {
+        minSlacks[j] -= delta;
+      }
+    }
+    goal = nextGoal;
+  } while (goalBoxes[goal] != -1);
+
+  // Flip matches along the path.
+  while (goal != n) {
+    int previous = previousGoals[goal];
+    goalBoxes[goal] = goalBoxes[previous];
+    assignment.goals[goalBoxes[goal]] = goal;
+    goal = previous;
+  }
+}
+
+int DistanceTable::SumMatching(const std::vector<Position> &boxes,
+                               GoalAssignment &assignment) const {
+  int n = boxes.size();
+  int totalDistance = 0;
+  assignment.distances.resize(n);
+  for (int i = 0; i < n; i++) {
+    assignment.distances[i] = Cost(boxes[i], assignment.goals[i]);
+    totalDistance += assignment.distances[i];
+  }
+
+  assignment.totalDistance = totalDistance;
+  return CapDistance(totalDistance);
+}
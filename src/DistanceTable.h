@@ -1,15 +1,113 @@
 #pragma once
 
+#include <cstdint>
+
 #include "Board.h"
+#include "PatternDatabase.h"
+
+enum class Heuristic {
+  GREEDY,    // match boxes in order to their nearest unmatched goals
+  MATCHING,  // minimum-cost perfect matching of boxes to goals
+};
+
+// How boxes move towards their targets.
+enum class BoxMove { PUSH, PULL };
 
+// Matching of boxes to goals underlying a distance estimate. For the matching
+// heuristic, the dual potentials of the Hungarian algorithm are kept too, so
+// that the matching may be repaired after a single box moves. Greedy matches
+// leave boxes stranded by earlier matches unmatched (-1).
+struct GoalAssignment {
+  std::vector<int> goals;
+  std::vector<int> distances;
+  std::vector<int> boxPotentials;
+  std::vector<int> goalPotentials;
+  int totalDistance;
+};
+
+// Estimates the pushes needed to move boxes onto goals, from a lower bound on
+// the pushes needed by each box alone. Single-box distances respect the need
+// for the player to stand behind a box to push it, and for the player to walk
+// around the box to change sides. If a pattern database is given, the larger
+// of the two estimates is used.
 class DistanceTable {
 public:
-  DistanceTable(const Board &board);
+  // Estimate reported for deadlocked states, which leaves headroom for
+  // g-values in 16-bit state fields. N.B., this is only reported for states
+  // proven deadlocked, so such states may be pruned.
+  static const int DEADLOCK_DISTANCE = UINT16_MAX / 2;
+
+  DistanceTable(const Board &board,
+                Heuristic heuristic = Heuristic::GREEDY,
+                const PatternDatabase *patternDatabase = nullptr);
+
+  // Estimates distances to the given targets rather than the board's goals,
+  // moving boxes by the given kind of move. N.B., a pattern database only
+  // applies if the targets are the board's goals.
+  DistanceTable(const Board &board,
+                const std::vector<Position> &targets,
+                BoxMove move,
+                Heuristic heuristic = Heuristic::GREEDY,
+                const PatternDatabase *patternDatabase = nullptr);
 
   int EstimateDistance(const std::vector<Position> &boxes) const;
+  int EstimateDistance(const std::vector<Position> &boxes,
+                       GoalAssignment &assignment) const;
+
+  // Re-estimates the distance after a single box has moved, given the
+  // assignment from before the move. Equivalent to EstimateDistance(), but
+  // greedy matches are only redone from the moved box onwards, while
+  // minimum-cost matchings are repaired with a single augmenting path in
+  // O(n^2) rather than recomputed in O(n^3).
+  int UpdateDistance(const std::vector<Position> &boxes,
+                     int movedBox,
+                     const GoalAssignment &assignment) const;
+
+  // Whether the box can be pushed onto the given target at all.
+  bool CanReach(Position box, int target) const {
+    return distances[target][box] != -1;
+  }
+  int TargetCount() const { return distances.size(); }
 
 private:
+  void FindSideGroups();
+  void VisitSides(Position box,
+                  Direction side,
+                  int distance,
+                  std::vector<int> &sideDistances,
+                  std::vector<int> &queue) const;
+
+  int FindNearestGoal(Position box, int &bufferIndex) const;
+  int MatchBoxes(const std::vector<Position> &boxes,
+                 int firstBox,
+                 GoalAssignment *assignment) const;
+  void ResetGoals() const;
+  void RemoveGoal(int bufferIndex) const;
+
+  static int CapDistance(int totalDistance);
+  int CombineDistance(const std::vector<Position> &boxes, int distance) const;
+  int Cost(Position box, int goal) const;
+  int FindMatching(const std::vector<Position> &boxes,
+                   GoalAssignment &assignment) const;
+  int RepairMatching(const std::vector<Position> &boxes,
+                     int movedBox,
+                     GoalAssignment &assignment) const;
+  void Augment(const std::vector<Position> &boxes,
+               int box,
+               GoalAssignment &assignment) const;
+  int SumMatching(const std::vector<Position> &boxes,
+                  GoalAssignment &assignment) const;
+
   const Board &board;
+  Heuristic heuristic;
+  const PatternDatabase *patternDatabase;
   std::vector<std::vector<int>> distances;
+  std::vector<int> sideGroups;
   mutable std::vector<int> buffer;
+  mutable std::vector<int> bufferIndices;
+  mutable GoalAssignment scratch;
+  mutable std::vector<int> goalBoxes;
+  mutable std::vector<int> minSlacks;
+  mutable std::vector<int> previousGoals;
+  mutable std::vector<bool> visited;
 };
@@ -12,7 +12,7 @@ FreezeDeadlockDetector::FreezeDeadlockDetector(
 bool IsDeadlockInternal(const Board &board,
                         const SimpleDeadlockDetector &simpleDeadlockDetector,
                         Position position,
-                        std::vector<bool> &visited,
+                        ScratchSet &visited,
                         int &boxesVisited,
                         int &goalsVisited) {
   assert(board.HasBox(position));
@@ -20,7 +20,7 @@ bool IsDeadlockInternal(const Board &board,
   if (board.HasGoal(position)) {
     goalsVisited++;
   }
-  visited[position] = true;
+  visited.Insert(position);
   for (Direction dir : ALL_DIRECTIONS) {
     Position posFront = board.MovePosition(position, dir);
     Position posBack = board.UnmovePosition(position, dir);
@@ -28,7 +28,7 @@ bool IsDeadlockInternal(const Board &board,
         !simpleDeadlockDetector.IsDeadlock(posFront) &&
         !board.HasWall(posBack) && !board.HasBox(posBack) &&
         (!board.HasBox(posFront) ||
-         (!visited[posFront] &&
+         (!visited.Contains(posFront) &&
           !IsDeadlockInternal(board, simpleDeadlockDetector, posFront, visited,
                               boxesVisited, goalsVisited)))) {
       return false;
@@ -38,7 +38,7 @@ bool IsDeadlockInternal(const Board &board,
 }
 
 bool FreezeDeadlockDetector::IsDeadlock(Position position) {
-  std::fill(visited.begin(), visited.end(), false);
+  visited.Clear();
   int boxesVisited = 0;
   int goalsVisited = 0;
   return IsDeadlockInternal(board, simpleDeadlockDetector, position, visited,
@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "Board.h"
+#include "ScratchSet.h"
 #include "SimpleDeadlockDetector.h"
 
 class FreezeDeadlockDetector {
@@ -15,5 +16,5 @@ public:
 private:
   const Board &board;
   const SimpleDeadlockDetector &simpleDeadlockDetector;
-  std::vector<bool> visited;
+  ScratchSet visited;
 };
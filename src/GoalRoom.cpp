@@ -0,0 +1,220 @@
+#include "GoalRoom.h"
+
+#include <algorithm>
+#include <map>
+
+GoalRoom::GoalRoom(const Board &board)
+    : board(board),
+      entrance(-1),
+      entryDirection(Direction::UP),
+      inRoom(board.Size(), false) {
+  // Try each cell as the entrance. N.B., cells along a corridor leading into
+  // a room all cut off the same goals, and the smallest room is preferred.
+  int bestGoals = 0;
+  size_t bestSize = 0;
+  for (Position p = 0; p < board.Size(); p++) {
+    if (!FindRoom(p)) {
+      continue;
+    }
+    int goals = std::count_if(roomCells.begin(), roomCells.end(),
+                              [&](Position q) { return board.HasGoal(q); });
+    if (goals > bestGoals ||
+        (goals == bestGoals && roomCells.size() < bestSize)) {
+      bestGoals = goals;
+      bestSize = roomCells.size();
+      entrance = p;
+    }
+  }
+  if (bestGoals < 2) {
+    roomCells.clear();
+    return;
+  }
+  FindRoom(entrance);
+  for (Position p : roomCells) {
+    inRoom[p] = true;
+  }
+
+  // Empty the room's goals one at a time, choosing each time the goal whose
+  // box could be pushed in last most cheaply. Reversed, this is the packing
+  // order.
+  std::vector<bool> filled(board.Size(), false);
+  std::vector<Position> goals;
+  for (Position p : roomCells) {
+    if (board.HasGoal(p)) {
+      filled[p] = true;
+      goals.push_back(p);
+    }
+  }
+  std::vector<Push> path;
+  while (!goals.empty()) {
+    int best = -1;
+    std::vector<Push> bestPath;
+    for (int i = 0; i < goals.size(); i++) {
+      filled[goals[i]] = false;
+      if (FindPath(goals[i], filled, path) &&
+          (best == -1 || path.size() < bestPath.size())) {
+        best = i;
+        bestPath = path;
+      }
+      filled[goals[i]] = true;
+    }
+    if (best == -1) {
+      slots.clear();
+      slotPaths.clear();
+      return;
+    }
+    filled[goals[best]] = false;
+    slots.push_back(goals[best]);
+    slotPaths.push_back(bestPath);
+    goals.erase(goals.begin() + best);
+  }
+  std::reverse(slots.begin(), slots.end());
+  std::reverse(slotPaths.begin(), slotPaths.end());
+}
+
+bool GoalRoom::FindRoom(Position candidate) {
+  roomCells.clear();
+  if (!board.IsInterior(candidate) || candidate == board.Player() ||
+      board.HasGoal(candidate) || board.HasBox(candidate)) {
+    return false;
+  }
+
+  // Find the cells the player cannot reach without crossing the candidate.
+  std::vector<bool> outside(board.Size(), false);
+  std::vector<Position> stack = {board.Player()};
+  outside[board.Player()] = true;
+  while (!stack.empty()) {
+    Position p = stack.back();
+    stack.pop_back();
+    for (Direction d : ALL_DIRECTIONS) {
+      Position p2 = board.MovePosition(p, d);
+      if (!outside[p2] && !board.HasWall(p2) && p2 != candidate) {
+        outside[p2] = true;
+        stack.push_back(p2);
+      }
+    }
+  }
+
+  // N.B., the room must be entered from a single side, so that boxes enter
+  // it by a single push.
+  int sides = 0;
+  for (Direction d : ALL_DIRECTIONS) {
+    Position p = board.MovePosition(candidate, d);
+    if (board.IsInterior(p) && !outside[p]) {
+      sides++;
+      entryDirection = d;
+    }
+  }
+  if (sides != 1 ||
+      !outside[board.UnmovePosition(candidate, entryDirection)]) {
+    return false;
+  }
+  for (Position p = 0; p < board.Size(); p++) {
+    if (board.IsInterior(p) && !outside[p] && p != candidate) {
+      if (board.HasBox(p)) {
+        roomCells.clear();
+        return false;
+      }
+      roomCells.push_back(p);
+    }
+  }
+  return true;
+}
+
+bool GoalRoom::FindPath(Position goal,
+                        const std::vector<bool> &filled,
+                        std::vector<Push> &path) const {
+  // Breadth-first search over pushes of a single box from the entrance to
+  // the goal, past the filled goals. N.B., the player is kept inside the room
+  // (or on the entrance), so that boxes outside the room cannot interfere.
+  struct Node {
+    Position box;
+    Position player;
+    int parent;
+    Push push;
+  };
+  Position first = board.MovePosition(entrance, entryDirection);
+  if (filled[first]) {
+    return false;
+  }
+  std::vector<bool> reached;
+  std::vector<Node> nodes = {
+      {first, Reach(entrance, first, filled, reached), -1,
+       Push(entrance, entryDirection)}};
+  std::map<std::pair<Position, Position>, int> visited = {
+      {{nodes[0].box, nodes[0].player}, 0}};
+  for (int head = 0; head < nodes.size(); head++) {
+    Node node = nodes[head];
+    Reach(node.player, node.box, filled, reached);
+    if (node.box == goal) {
+      // The player must still be able to leave, to bring the next box.
+      if (!reached[entrance]) {
+        continue;
+      }
+      path.clear();
+      for (int i = head; i != -1; i = nodes[i].parent) {
+        path.push_back(nodes[i].push);
+      }
+      std::reverse(path.begin(), path.end());
+      return true;
+    }
+    for (Direction d : ALL_DIRECTIONS) {
+      Position to = board.MovePosition(node.box, d);
+      if (!reached[board.UnmovePosition(node.box, d)] || !inRoom[to] ||
+          filled[to]) {
+        continue;
+      }
+      std::vector<bool> childReached;
+      Position player = Reach(node.box, to, filled, childReached);
+      if (visited.emplace(std::make_pair(to, player), nodes.size()).second) {
+        nodes.push_back({to, player, head, Push(node.box, d)});
+      }
+    }
+  }
+  return false;
+}
+
+Position GoalRoom::Reach(Position player,
+                         Position box,
+                         const std::vector<bool> &filled,
+                         std::vector<bool> &reached) const {
+  reached.assign(board.Size(), false);
+  reached[player] = true;
+  Position result = player;
+  std::vector<Position> stack = {player};
+  while (!stack.empty()) {
+    Position p = stack.back();
+    stack.pop_back();
+    result = std::min(result, p);
+    for (Direction d : ALL_DIRECTIONS) {
+      Position p2 = board.MovePosition(p, d);
+      if (!reached[p2] && (inRoom[p2] || p2 == entrance) && !filled[p2] &&
+          p2 != box) {
+        reached[p2] = true;
+        stack.push_back(p2);
+      }
+    }
+  }
+  return result;
+}
+
+bool GoalRoom::FindMacro(const Push &push, std::vector<Push> &pushes) const {
+  if (!Found() || push.Box() != entrance ||
+      push.Direction() != entryDirection) {
+    return false;
+  }
+
+  // The room must hold exactly the boxes of its first slots.
+  int packed = std::count_if(roomCells.begin(), roomCells.end(),
+                             [&](Position p) { return board.HasBox(p); });
+  if (packed >= slots.size()) {
+    return false;
+  }
+  for (int i = 0; i < packed; i++) {
+    if (!board.HasBox(slots[i])) {
+      return false;
+    }
+  }
+  pushes = slotPaths[packed];
+  return true;
+}
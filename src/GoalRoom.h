@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+#include "Board.h"
+
+// Goal room reachable only through a single entrance cell, with an order in
+// which boxes can be packed onto its goals. The packing order is found by
+// retrograde analysis: starting from the filled room, goals are emptied one
+// at a time, each only if a box pushed in through the entrance could still
+// reach it past the goals that remain filled.
+//
+// Once a room is found, a box pushed into it while it holds exactly the
+// boxes of its first slots can be moved straight to the next slot along a
+// precomputed path. N.B., this commits to the packing order, so solutions
+// may be longer than optimal (or missed, if the level needs the room packed
+// some other way).
+class GoalRoom {
+public:
+  GoalRoom(const Board &board);
+
+  bool Found() const { return !slots.empty(); }
+  int SlotCount() const { return slots.size(); }
+
+  // Gets the pushes moving a box from the room's entrance to its next slot,
+  // if the push moves a box into the room while the room is packed up to
+  // that slot.
+  bool FindMacro(const Push &push, std::vector<Push> &pushes) const;
+
+private:
+  bool FindRoom(Position entrance);
+  bool FindPath(Position goal,
+                const std::vector<bool> &filled,
+                std::vector<Push> &path) const;
+  Position Reach(Position player,
+                 Position box,
+                 const std::vector<bool> &filled,
+                 std::vector<bool> &reached) const;
+
+  const Board &board;
+  Position entrance;
+  Direction entryDirection;
+  std::vector<bool> inRoom;
+  std::vector<Position> roomCells;
+  std::vector<Position> slots;
+  std::vector<std::vector<Push>> slotPaths;
+};
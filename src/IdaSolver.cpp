@@ -0,0 +1,155 @@
+#include "IdaSolver.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+
+#include "Solution.h"
+
+// Search() results signalling that a solution was found, the state limit was
+// reached, or the state closes a cycle on the current search path. Otherwise
+// Search() returns the smallest f-value exceeding the bound, or INT_MAX for
+// dead ends.
+static const int FOUND = -1;
+static const int ABORTED = -2;
+static const int CYCLE = -3;
+
+IdaSolver::IdaSolver(Board &board, const SolverOptions &options)
+    : board(board),
+      simpleDeadlockDetector(board),
+      freezeDeadlockDetector(board, simpleDeadlockDetector),
+      pushSearcher(board, simpleDeadlockDetector, nullptr, options.reachability),
+      distanceTable(board, options.heuristic, options.patternDatabase),
+      transpositionTable(options.transpositionTableBytes),
+      options(options),
+      iteration(0),
+      statesVisited(0),
+      cycleHits(0) {}
+
+SolveResult IdaSolver::Solve() {
+  if (board.Done()) {
+    return SolveResult(true, 0, 0, 0);
+  }
+
+  Position initialPlayer = board.Player();
+  board.MovePlayer(pushSearcher.FindNormalizedPlayer());
+  int bound = distanceTable.EstimateDistance(board.Boxes());
+  int result = bound;
+
+  // N.B., the root's estimate is only DEADLOCK_DISTANCE for levels proven
+  // unsolvable, as for any other state.
+  if (bound >= DistanceTable::DEADLOCK_DISTANCE) {
+    result = INT_MAX;
+  }
+  while (result != FOUND && result != ABORTED && result != INT_MAX) {
+    iteration++;
+    bound = result;
+    result = Search(0, bound, 0);
+  }
+
+  size_t memoryUsed = transpositionTable.MemoryUsage();
+  for (const std::vector<Push> &pushes : pushStack) {
+    memoryUsed += pushes.capacity() * sizeof(Push);
+  }
+  // N.B., the bound only limits the solution's length, as the heuristic need
+  // not be admissible.
+  SolveResult solveResult(result == FOUND, statesVisited,
+                          result == FOUND ? (int)solutionPath.size() : -1,
+                          memoryUsed);
+
+  // Recover the solution, which was collected in reverse while unwinding.
+  if (result == FOUND) {
+    std::reverse(solutionPath.begin(), solutionPath.end());
+    board.MovePlayer(initialPlayer);
+    solveResult.solution = ExpandPushes(board, solutionPath);
+  }
+  return solveResult;
+}
+
+int IdaSolver::Search(int gValue, int bound, int depth) {
+  // N.B., the board is expected to be normalized on entry.
+  uint64_t hash = board.Hash();
+  int hValue = distanceTable.EstimateDistance(board.Boxes());
+
+  // A state still on the current search path closes a cycle, which never
+  // leads to a shorter solution. A transposition searched earlier in this
+  // iteration at a lower-or-equal g-value needs no further work; earlier
+  // iterations may have raised its lower bound. N.B., only completed entries
+  // hold finished lower bounds.
+  TranspositionEntry *entry = transpositionTable.Find(hash);
+  if (entry && entry->inProgress && entry->iteration == iteration) {
+    cycleHits++;
+    return CYCLE;
+  }
+  if (entry && !entry->inProgress) {
+    if (entry->iteration == iteration && entry->gValue <= gValue) {
+      // N.B., entries whose bounds were left unchanged still exceed the
+      // current bound, as they were searched in full.
+      return std::max(gValue + std::max(hValue, (int)entry->hValue),
+                      bound + 1);
+    }
+    hValue = std::max(hValue, (int)entry->hValue);
+  }
+  if (hValue >= DistanceTable::DEADLOCK_DISTANCE) {
+    return INT_MAX;
+  }
+
+  int fValue = gValue + hValue;
+  if (fValue > bound) {
+    return fValue;
+  }
+  if (board.Done()) {
+    return FOUND;
+  }
+  if (statesVisited >= options.maxStates) {
+    return ABORTED;
+  }
+  statesVisited++;
+  transpositionTable.Store(hash, gValue, hValue, iteration, true);
+
+  // Generate children.
+  if (depth >= pushStack.size()) {
+    pushStack.resize(depth + 1);
+  }
+  std::vector<Push> &pushes = pushStack[depth];
+  pushSearcher.FindPushes(pushes);
+  int nextBound = INT_MAX;
+  int initialCycleHits = cycleHits;
+  for (const Push &p : pushes) {
+    board.PerformPush(p);
+
+    // Check for potential freeze deadlock.
+    Position boxTo = board.MovePosition(p.Box(), p.Direction());
+    if (freezeDeadlockDetector.IsDeadlock(boxTo)) {
+      board.PerformUnpush(p);
+      continue;
+    }
+
+    board.MovePlayer(pushSearcher.FindNormalizedPlayer());
+    int result = Search(gValue + 1, bound, depth + 1);
+    board.PerformUnpush(p);
+    if (result == FOUND) {
+      solutionPath.push_back(p);
+      return result;
+    }
+    if (result == ABORTED) {
+      return result;
+    }
+    if (result != CYCLE) {
+      nextBound = std::min(nextBound, result);
+    }
+  }
+
+  // Remember the improved lower bound for later iterations. N.B., cycles
+  // only exist relative to the current search path, so bounds found with
+  // cycles cut off somewhere below are not kept.
+  if (cycleHits != initialCycleHits) {
+    transpositionTable.Store(hash, gValue, hValue, iteration);
+  } else if (nextBound != INT_MAX) {
+    transpositionTable.Store(hash, gValue, nextBound - gValue, iteration);
+  } else {
+    // N.B., a state without viable children can never be solved.
+    transpositionTable.Store(hash, gValue, UINT16_MAX, iteration);
+  }
+  return nextBound;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+
+#include "Board.h"
+#include "DistanceTable.h"
+#include "FreezeDeadlockDetector.h"
+#include "PushSearcher.h"
+#include "SimpleDeadlockDetector.h"
+#include "SolveResult.h"
+#include "SolverOptions.h"
+#include "TranspositionTable.h"
+
+// Iterative-deepening A* (IDA*). Searches depth-first with increasing f-value
+// bounds, so memory use is bounded by the search depth plus a fixed-size
+// transposition table, which detects transpositions within an iteration and
+// carries improved lower bounds across iterations.
+class IdaSolver {
+public:
+  IdaSolver(Board &board, const SolverOptions &options);
+
+  SolveResult Solve();
+
+private:
+  int Search(int gValue, int bound, int depth);
+
+  Board &board;
+  SimpleDeadlockDetector simpleDeadlockDetector;
+  FreezeDeadlockDetector freezeDeadlockDetector;
+  PushSearcher pushSearcher;
+  DistanceTable distanceTable;
+  TranspositionTable transpositionTable;
+  std::vector<std::vector<Push>> pushStack;
+  std::vector<Push> solutionPath;
+  SolverOptions options;
+  int iteration;
+  int statesVisited;
+  int cycleHits;
+};
@@ -0,0 +1,133 @@
+#include "IndexedHeap.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+
+IndexedHeap::IndexedHeap(TieBreak tieBreak)
+    : tieBreak(tieBreak), sequence(0) {}
+
+IndexedHeap::Entry IndexedHeap::MakeEntry(StateId id,
+                                          int fValue,
+                                          int gValue,
+                                          int hValue) {
+  int rank = 0;
+  switch (tieBreak) {
+  case TieBreak::DEEPEST_G:
+    rank = fValue - gValue;
+    break;
+  case TieBreak::LOWEST_H:
+    rank = hValue;
+    break;
+  case TieBreak::LIFO:
+    break;
+  }
+  return {fValue, rank, sequence++, id};
+}
+
+bool IndexedHeap::Less(const Entry &e1, const Entry &e2) const {
+  if (e1.fValue != e2.fValue) {
+    return e1.fValue < e2.fValue;
+  }
+  if (e1.rank != e2.rank) {
+    return e1.rank < e2.rank;
+  }
+  // N.B., later entries win ties, matching the LIFO buckets of BucketQueue.
+  return e1.sequence > e2.sequence;
+}
+
+void IndexedHeap::Place(size_t index, const Entry &entry) {
+  heap[index] = entry;
+  positions[entry.id] = index;
+}
+
+void IndexedHeap::Push(StateId id, int fValue, int gValue, int hValue) {
+  if (id >= positions.size()) {
+    positions.resize(id + 1);
+  }
+  heap.push_back(MakeEntry(id, fValue, gValue, hValue));
+  positions[id] = heap.size() - 1;
+  SiftUp(heap.size() - 1);
+}
+
+void IndexedHeap::Update(StateId id, int fValue, int gValue, int hValue) {
+  size_t index = positions[id];
+  assert(heap[index].id == id);
+  Entry entry = MakeEntry(id, fValue, gValue, hValue);
+  bool decreased = Less(entry, heap[index]);
+  heap[index] = entry;
+  if (decreased) {
+    SiftUp(index);
+  } else {
+    SiftDown(index);
+  }
+}
+
+StateId IndexedHeap::Pop() {
+  assert(!heap.empty());
+  StateId id = heap[0].id;
+  Entry last = heap.back();
+  heap.pop_back();
+  if (!heap.empty()) {
+    Place(0, last);
+    SiftDown(0);
+  }
+  return id;
+}
+
+void IndexedHeap::Evict(size_t count, std::vector<StateId> &evicted) {
+  count = std::min(count, heap.size());
+  size_t kept = heap.size() - count;
+  std::nth_element(
+      heap.begin(), heap.begin() + kept, heap.end(),
+      [this](const Entry &e1, const Entry &e2) { return Less(e1, e2); });
+  for (size_t i = kept; i < heap.size(); i++) {
+    evicted.push_back(heap[i].id);
+  }
+  heap.resize(kept);
+
+  // Restore the heap property over the surviving entries.
+  for (size_t i = 0; i < heap.size(); i++) {
+    positions[heap[i].id] = i;
+  }
+  for (size_t i = heap.size() / 2; i-- > 0;) {
+    SiftDown(i);
+  }
+}
+
+void IndexedHeap::SiftUp(size_t index) {
+  Entry entry = heap[index];
+  while (index > 0) {
+    size_t parent = (index - 1) / 2;
+    if (!Less(entry, heap[parent])) {
+      break;
+    }
+    Place(index, heap[parent]);
+    index = parent;
+  }
+  Place(index, entry);
+}
+
+void IndexedHeap::SiftDown(size_t index) {
+  Entry entry = heap[index];
+  while (true) {
+    size_t child = 2 * index + 1;
+    if (child >= heap.size()) {
+      break;
+    }
+    if (child + 1 < heap.size() && Less(heap[child + 1], heap[child])) {
+      child++;
+    }
+    if (!Less(heap[child], entry)) {
+      break;
+    }
+    Place(index, heap[child]);
+    index = child;
+  }
+  Place(index, entry);
+}
+
+size_t IndexedHeap::MemoryUsage() const {
+  return heap.capacity() * sizeof(Entry) +
+         positions.capacity() * sizeof(uint32_t);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "OpenList.h"
+
+// Binary min-heap of open states in which every state knows its heap slot,
+// so that key updates are performed in place in O(log n).
+class IndexedHeap : public OpenList {
+public:
+  IndexedHeap(TieBreak tieBreak);
+
+  void Push(StateId id, int fValue, int gValue, int hValue) override;
+  void Update(StateId id, int fValue, int gValue, int hValue) override;
+  StateId Pop() override;
+  void Evict(size_t count, std::vector<StateId> &evicted) override;
+
+  bool Empty() const override { return heap.empty(); }
+  size_t Size() const override { return heap.size(); }
+  size_t MemoryUsage() const override;
+
+private:
+  struct Entry {
+    int fValue;
+    int rank;
+    uint32_t sequence;
+    StateId id;
+  };
+
+  Entry MakeEntry(StateId id, int fValue, int gValue, int hValue);
+  bool Less(const Entry &e1, const Entry &e2) const;
+  void Place(size_t index, const Entry &entry);
+  void SiftUp(size_t index);
+  void SiftDown(size_t index);
+
+  TieBreak tieBreak;
+  std::vector<Entry> heap;
+  std::vector<uint32_t> positions;
+  uint32_t sequence;
+};
@@ -0,0 +1,141 @@
+#include "MemoryBudget.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+// Number of expansions between memory usage checks.
+static const int CHECK_INTERVAL = 1024;
+
+// Minimum number of recycled states kept available while evicting, which must
+// cover the children of any single expansion.
+static const size_t MIN_FREE_STATES = 1024;
+
+MemoryBudget::MemoryBudget(size_t budgetBytes,
+                           StateStore &states,
+                           StateTable &stateTable,
+                           OpenList &openList,
+                           const DeadlockDatabase *deadlockDatabase,
+                           CorralDeadlockDetector &corralDeadlockDetector,
+                           std::function<int(int, int)> priority)
+    : budgetBytes(budgetBytes),
+      states(states),
+      stateTable(stateTable),
+      openList(openList),
+      deadlockDatabase(deadlockDatabase),
+      corralDeadlockDetector(corralDeadlockDetector),
+      priority(std::move(priority)),
+      // N.B., usage is first checked on the first expansion.
+      checkCountdown(1),
+      statesEvicted(0),
+      evicting(false),
+      stalled(false) {}
+
+size_t MemoryBudget::MemoryUsage() const {
+  return states.MemoryUsage() + stateTable.MemoryUsage() +
+         openList.MemoryUsage() +
+         (deadlockDatabase ? deadlockDatabase->MemoryUsage() : 0) +
+         corralDeadlockDetector.MemoryUsage();
+}
+
+bool MemoryBudget::Enforce(Board &board, bool &lazyPushes) {
+  // Keep a pool of recycled states available while evicting. N.B., if no
+  // states can be evicted, the search may grow until the next check.
+  if (evicting && !stalled && states.FreeCount() < MIN_FREE_STATES) {
+    stalled = !Evict(board);
+  }
+
+  if (--checkCountdown > 0) {
+    return true;
+  }
+  checkCountdown = CHECK_INTERVAL;
+  stalled = false;
+
+  // N.B., degrade once usage passes half the budget, since the containers
+  // grow geometrically and may double in size at any point.
+  size_t used = MemoryUsage();
+  if (used <= budgetBytes / 2) {
+    return true;
+  }
+  if (!lazyPushes) {
+    lazyPushes = true;
+    states.DropPushes();
+    used = MemoryUsage();
+  }
+  if (used > budgetBytes) {
+    corralDeadlockDetector.ClearCache();
+    used = MemoryUsage();
+  }
+  if (!evicting && used > budgetBytes / 2) {
+    evicting = true;
+    stalled = !Evict(board);
+  } else if (used > budgetBytes) {
+    stalled = !Evict(board);
+  }
+
+  // N.B., as storage is recycled, usage does not drop after evicting, but the
+  // search stops growing.
+  return used <= budgetBytes || !stalled;
+}
+
+bool MemoryBudget::Evict(Board &board) {
+  // N.B., always keep the most promising open state.
+  size_t target = std::max(openList.Size() / 8, MIN_FREE_STATES);
+  evicted.clear();
+  reopened.clear();
+  while (evicted.size() < target && openList.Size() > 1) {
+    size_t begin = evicted.size();
+    openList.Evict(std::min(target - begin, openList.Size() - 1), evicted);
+
+    // Forget the evicted states. Expanded (i.e., re-opened) states may still
+    // be referenced as parents, so they are set aside and kept open.
+    size_t end = begin;
+    for (size_t i = begin; i < evicted.size(); i++) {
+      StateId id = evicted[i];
+      if (states.IsExpanded(id)) {
+        reopened.push_back(id);
+        continue;
+      }
+      states.Restore(id, board);
+      stateTable.Remove(stateTable.Find(board.Hash(), id));
+      states.Free(id);
+      evicted[end++] = id;
+    }
+    evicted.resize(end);
+  }
+  for (StateId id : reopened) {
+    int gValue = states.GValue(id);
+    int hValue = states.HValue(id);
+    openList.Push(id, priority(gValue, hValue), gValue, hValue);
+  }
+  if (evicted.empty()) {
+    return false;
+  }
+  statesEvicted += evicted.size();
+
+  // Re-open the parents of evicted states, so that they may be regenerated.
+  // As in SMA*, parents inherit the f-values of their best evicted children.
+  for (StateId id : evicted) {
+    StateId parent = states.Parent(id);
+    if (parent == NO_STATE) {
+      continue;
+    }
+    states.Restore(parent, board);
+    StateTableSlot *slot = stateTable.Find(board.Hash(), parent);
+    assert(slot);
+    int gValue = states.GValue(parent);
+    int fValue = states.FValue(id);
+    if (slot->status != StateStatus::OPEN) {
+      fValue = std::max(fValue, states.FValue(parent));
+      slot->status = StateStatus::OPEN;
+      states.SetHValue(parent, fValue - gValue);
+      openList.Push(parent, priority(gValue, fValue - gValue), gValue,
+                    fValue - gValue);
+    } else if (fValue < states.FValue(parent)) {
+      states.SetHValue(parent, fValue - gValue);
+      openList.Update(parent, priority(gValue, fValue - gValue), gValue,
+                      fValue - gValue);
+    }
+  }
+  return true;
+}
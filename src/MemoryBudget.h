@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "Board.h"
+#include "CorralDeadlockDetector.h"
+#include "DeadlockDatabase.h"
+#include "OpenList.h"
+#include "StateStore.h"
+#include "StateTable.h"
+
+// Accounts for the memory held by a search's state store, state table and open
+// list, as well as by its deadlock detectors, and degrades the search
+// gracefully as it approaches a budget:
+//
+// 1. Stored push lists are dropped, and pushes are regenerated on expansion
+//    from then on.
+// 2. The least promising open states are evicted in batches and their storage
+//    is recycled for new states, so that the search stops growing. As in SMA*,
+//    the parents of evicted states are re-opened so they may be regenerated.
+// 3. Once over budget, cached corral deadlock results are dropped, and states
+//    are evicted at every check.
+//
+// Only once nothing more can be evicted while over budget is it aborted.
+// N.B., once evicting, solutions are no longer guaranteed to be optimal.
+class MemoryBudget {
+public:
+  // Open states are keyed by the given function of their g- and h-values.
+  MemoryBudget(size_t budgetBytes,
+               StateStore &states,
+               StateTable &stateTable,
+               OpenList &openList,
+               const DeadlockDatabase *deadlockDatabase,
+               CorralDeadlockDetector &corralDeadlockDetector,
+               std::function<int(int, int)> priority);
+
+  size_t MemoryUsage() const;
+
+  // Enforces the budget before the next expansion, using the board as scratch
+  // space. Returns false if the budget can no longer be met.
+  bool Enforce(Board &board, bool &lazyPushes);
+
+  int StatesEvicted() const { return statesEvicted; }
+
+private:
+  bool Evict(Board &board);
+
+  size_t budgetBytes;
+  StateStore &states;
+  StateTable &stateTable;
+  OpenList &openList;
+  const DeadlockDatabase *deadlockDatabase;
+  CorralDeadlockDetector &corralDeadlockDetector;
+  std::function<int(int, int)> priority;
+  std::vector<StateId> evicted;
+  std::vector<StateId> reopened;
+  int checkCountdown;
+  int statesEvicted;
+  bool evicting;
+  bool stalled;
+};
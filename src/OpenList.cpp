@@ -0,0 +1,17 @@
+#include "OpenList.h"
+
+#include <cstdlib>
+
+#include "BucketQueue.h"
+#include "IndexedHeap.h"
+
+std::unique_ptr<OpenList> OpenList::Create(OpenListType type,
+                                           TieBreak tieBreak) {
+  switch (type) {
+  case OpenListType::BUCKET:
+    return std::make_unique<BucketQueue>(tieBreak);
+  case OpenListType::HEAP:
+    return std::make_unique<IndexedHeap>(tieBreak);
+  }
+  std::abort();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "StateStore.h"
+
+// Policy for ordering states with equal f-values.
+enum class TieBreak {
+  DEEPEST_G,  // prefer states with larger g-values
+  LOWEST_H,   // prefer states with smaller h-values
+  LIFO,       // prefer the most recently pushed state
+};
+
+enum class OpenListType { BUCKET, HEAP };
+
+// Priority queue of open states ordered by f-value and then by a tie-break
+// policy. Implementations track the position of every queued state so that
+// its key may be updated in place when a cheaper path to it is found.
+class OpenList {
+public:
+  static std::unique_ptr<OpenList> Create(OpenListType type, TieBreak tieBreak);
+
+  virtual ~OpenList() {}
+
+  virtual void Push(StateId id, int fValue, int gValue, int hValue) = 0;
+  virtual void Update(StateId id, int fValue, int gValue, int hValue) = 0;
+  virtual StateId Pop() = 0;
+
+  // Removes up to the given number of the least promising states, appending
+  // their ids to the given vector.
+  virtual void Evict(size_t count, std::vector<StateId> &evicted) = 0;
+
+  virtual bool Empty() const = 0;
+  virtual size_t Size() const = 0;
+  virtual size_t MemoryUsage() const = 0;
+};
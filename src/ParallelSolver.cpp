@@ -0,0 +1,402 @@
+#include "ParallelSolver.h"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <stdexcept>
+#include <thread>
+
+#include "BipartiteDeadlockDetector.h"
+#include "CorralDeadlockDetector.h"
+#include "DistanceTable.h"
+#include "FreezeDeadlockDetector.h"
+#include "OpenList.h"
+#include "PushSearcher.h"
+#include "Solution.h"
+#include "StateStore.h"
+#include "StateTable.h"
+
+// Number of messages buffered for another worker before sending them.
+static const size_t BATCH_SIZE = 64;
+
+// Number of expansions between flushes of partially filled batches.
+static const int FLUSH_INTERVAL = 16;
+
+// Number of words preceding the state record in a message.
+static const int MESSAGE_HEADER = 5;
+
+// A batch of child states sent from one worker to another. Each message is
+// laid out in "values" as its g-value, h-value, global parent id (two words)
+// and parent push code, followed by the packed state record.
+struct ParallelSolver::Batch {
+  std::vector<uint64_t> hashes;
+  std::vector<uint16_t> values;
+  Batch *next = nullptr;
+};
+
+struct ParallelSolver::Worker {
+  Board board;
+  FreezeDeadlockDetector freezeDeadlockDetector;
+  CorralDeadlockDetector corralDeadlockDetector;
+  PushSearcher pushSearcher;
+  DistanceTable distanceTable;
+  BipartiteDeadlockDetector bipartiteDeadlockDetector;
+  StateStore states;
+  StateTable stateTable;
+  std::unique_ptr<OpenList> openList;
+  std::atomic<Batch *> mailbox;
+  std::vector<std::unique_ptr<Batch>> outgoing;
+  std::vector<Push> pushes;
+  std::vector<Position> parentBoxes;
+  GoalAssignment assignment;
+  std::vector<Push> noPushes;
+  WorkerStats stats;
+  int index;
+
+  Worker(const Board &initialBoard,
+         const SimpleDeadlockDetector &simpleDeadlockDetector,
+         const SolverOptions &options,
+         int index,
+         int workerCount)
+      : board(initialBoard),
+        freezeDeadlockDetector(board, simpleDeadlockDetector),
+        corralDeadlockDetector(board, simpleDeadlockDetector),
+        pushSearcher(board,
+                     simpleDeadlockDetector,
+                     &corralDeadlockDetector,
+                     options.reachability),
+        distanceTable(board, options.heuristic, options.patternDatabase),
+        bipartiteDeadlockDetector(board, distanceTable),
+        states(board),
+        stateTable(states),
+        openList(OpenList::Create(options.openList, options.tieBreak)),
+        mailbox(nullptr),
+        outgoing(workerCount),
+        stats{0, 0, 0, 0, 0},
+        index(index) {}
+
+  ~Worker() {
+    Batch *batch = mailbox.load();
+    while (batch) {
+      Batch *next = batch->next;
+      delete batch;
+      batch = next;
+    }
+  }
+};
+
+ParallelSolver::ParallelSolver(const Board &board, const SolverOptions &options)
+    : board(board),
+      options(options),
+      simpleDeadlockDetector(board),
+      statesVisited(0),
+      solutionPushes(INT_MAX),
+      solutionWorker(-1),
+      solutionState(NO_STATE),
+      pending(0),
+      done(false),
+      aborted(false) {
+  for (int i = 0; i < options.threads; i++) {
+    workers.emplace_back(std::make_unique<Worker>(
+        board, simpleDeadlockDetector, options, i, options.threads));
+  }
+}
+
+ParallelSolver::~ParallelSolver() {}
+
+int ParallelSolver::Owner(uint64_t hash) const {
+  // N.B., use the high bits since the state tables index by the low bits.
+  return (hash >> 32) % workers.size();
+}
+
+// Parents may live on other workers, so they are referred to by global ids
+// which interleave the ids of all workers.
+StateId ParallelSolver::GlobalId(const Worker &worker, StateId id) const {
+  if (id >= (NO_STATE - 1) / workers.size()) {
+    throw std::length_error("state store exhausted");
+  }
+  return id * workers.size() + worker.index;
+}
+
+SolveResult ParallelSolver::Solve() {
+  if (board.Done()) {
+    return SolveResult(true, 0, 0, 0);
+  }
+
+  // Normalize the initial state and hand it to its owner.
+  Worker &first = *workers[0];
+  first.board.MovePlayer(first.pushSearcher.FindNormalizedPlayer());
+  Worker &owner = *workers[Owner(first.board.Hash())];
+  owner.states.Pack(first.board);
+  Offer(owner, first.board.Hash(), 0,
+        first.distanceTable.EstimateDistance(first.board.Boxes()), NO_STATE,
+        0);
+
+  // Run the workers. Each worker counts as pending until it runs out of work.
+  pending = workers.size();
+  std::vector<std::thread> threads;
+  for (auto &worker : workers) {
+    threads.emplace_back(&ParallelSolver::Run, this, std::ref(*worker));
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  // Collect results. N.B., a solution is only proven optimal once every
+  // worker has run out of cheaper states, so as in serial A*, none is
+  // reported if the state limit stops the search first.
+  bool solved = solutionPushes != INT_MAX && !aborted;
+  SolveResult result(solved, statesVisited, solved ? solutionPushes.load() : -1,
+                     0);
+  for (auto &worker : workers) {
+    result.memoryUsed += worker->states.MemoryUsage() +
+                         worker->stateTable.MemoryUsage() +
+                         worker->openList->MemoryUsage() +
+                         worker->corralDeadlockDetector.MemoryUsage();
+    result.bipartiteDeadlocks += worker->stats.bipartiteDeadlocks;
+    result.corralDeadlocks += worker->stats.corralDeadlocks;
+    result.workerStats.push_back(worker->stats);
+  }
+
+  // Recover the solution by following parents across workers.
+  if (solved) {
+    std::vector<Push> path;
+    Worker *worker = workers[solutionWorker].get();
+    StateId id = solutionState;
+    while (worker->states.Parent(id) != NO_STATE) {
+      path.push_back(worker->states.ParentPush(id));
+      StateId parent = worker->states.Parent(id);
+      worker = workers[parent % workers.size()].get();
+      id = parent / workers.size();
+    }
+    std::reverse(path.begin(), path.end());
+    Board solutionBoard = board;
+    result.solution = ExpandPushes(solutionBoard, path);
+  }
+  return result;
+}
+
+void ParallelSolver::Run(Worker &worker) {
+  bool active = true;
+  int expansions = 0;
+  while (!done.load(std::memory_order_relaxed)) {
+    // Receive states routed to this worker.
+    // N.B., an idle worker re-activates before consuming its mail, so that
+    // the pending count cannot drop to zero while work remains.
+    Batch *batches = worker.mailbox.exchange(nullptr, std::memory_order_acquire);
+    if (batches) {
+      if (!active) {
+        pending++;
+        active = true;
+      }
+      Receive(worker, batches);
+    }
+
+    // Expand the best local state. States which cannot lead to a cheaper
+    // solution are closed without expansion; they are re-opened if a cheaper
+    // path to them arrives later.
+    if (!worker.openList->Empty()) {
+      StateId id = worker.openList->Pop();
+      if (worker.states.FValue(id) < solutionPushes) {
+        Expand(worker, id);
+        if (++expansions % FLUSH_INTERVAL == 0) {
+          Flush(worker);
+        }
+      } else {
+        worker.states.Restore(id, worker.board);
+        worker.stateTable.Find(worker.board.Hash(), id)->status =
+            StateStatus::CLOSED;
+      }
+      continue;
+    }
+
+    // Out of local work: publish buffered states and go idle. The search is
+    // over once no worker is active and no batch is in flight.
+    Flush(worker);
+    if (active) {
+      active = false;
+      pending--;
+    }
+    if (pending == 0) {
+      done = true;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void ParallelSolver::Expand(Worker &worker, StateId id) {
+  Board &board = worker.board;
+  StateStore &states = worker.states;
+
+  // Move from open list to closed list.
+  states.Restore(id, board);
+  StateTableSlot *slot = worker.stateTable.Find(board.Hash(), id);
+  assert(slot && slot->status == StateStatus::OPEN);
+  slot->status = StateStatus::CLOSED;
+  int gValue = states.GValue(id);
+  worker.stats.statesVisited++;
+  if (++statesVisited >= options.maxStates) {
+    aborted = true;
+    done = true;
+  }
+
+  // Record solutions rather than stopping, since other workers may still
+  // hold cheaper ones.
+  if (board.Done()) {
+    std::lock_guard<std::mutex> lock(solutionMutex);
+    if (gValue < solutionPushes) {
+      solutionPushes = gValue;
+      solutionWorker = worker.index;
+      solutionState = id;
+    }
+    return;
+  }
+
+  // Generate children and route them to their owners, leaving states whose
+  // PI-corral can never be resolved closed without children.
+  StateId globalId = GlobalId(worker, id);
+  if (worker.pushSearcher.FindPushes(worker.pushes).isCorralDeadlock) {
+    worker.stats.corralDeadlocks++;
+    return;
+  }
+  worker.parentBoxes = board.Boxes();
+  bool assigned = false;
+  bool matched = false;
+  for (const Push &p : worker.pushes) {
+    int movedBox = board.BoxIndex(p.Box());
+    board.PerformPush(p);
+
+    // Check for potential freeze deadlock.
+    Position boxTo = board.MovePosition(p.Box(), p.Direction());
+    if (worker.freezeDeadlockDetector.IsDeadlock(boxTo)) {
+      board.PerformUnpush(p);
+      continue;
+    }
+
+    // Check that the boxes can still be matched to distinct goals,
+    // incrementally from the parent's matching.
+    if (!matched) {
+      worker.bipartiteDeadlockDetector.IsDeadlock(worker.parentBoxes);
+      matched = true;
+    }
+    if (worker.bipartiteDeadlockDetector.IsDeadlock(board.Boxes(), movedBox)) {
+      worker.stats.bipartiteDeadlocks++;
+      board.PerformUnpush(p);
+      continue;
+    }
+
+    // Normalize the board and compute the heuristic. N.B., the parent's goal
+    // assignment is only found once a child survives the deadlock check, as
+    // a minimum-cost matching takes O(n^3) rather than O(n^2) to repair.
+    board.MovePlayer(worker.pushSearcher.FindNormalizedPlayer());
+    if (!assigned) {
+      worker.distanceTable.EstimateDistance(worker.parentBoxes,
+                                            worker.assignment);
+      assigned = true;
+    }
+    int childGValue = gValue + 1;
+    int childHValue = worker.distanceTable.UpdateDistance(
+        board.Boxes(), movedBox, worker.assignment);
+    if (childHValue == DistanceTable::DEADLOCK_DISTANCE ||
+        childGValue + childHValue >= solutionPushes) {
+      board.PerformUnpush(p);
+      continue;
+    }
+
+    int owner = Owner(board.Hash());
+    states.Pack(board);
+    if (owner == worker.index) {
+      Offer(worker, board.Hash(), childGValue, childHValue, globalId,
+            StateStore::EncodePush(p));
+    } else {
+      std::unique_ptr<Batch> &batch = worker.outgoing[owner];
+      if (!batch) {
+        batch.reset(new Batch());
+      }
+      batch->hashes.push_back(board.Hash());
+      batch->values.push_back(childGValue);
+      batch->values.push_back(childHValue);
+      batch->values.push_back(globalId & 0xffff);
+      batch->values.push_back(globalId >> 16);
+      batch->values.push_back(StateStore::EncodePush(p));
+      batch->values.insert(batch->values.end(), states.Packed(),
+                           states.Packed() + states.RecordWidth());
+      if (batch->hashes.size() >= BATCH_SIZE) {
+        Send(worker, owner);
+      }
+    }
+    board.PerformUnpush(p);
+  }
+}
+
+void ParallelSolver::Receive(Worker &worker, Batch *batches) {
+  int width = MESSAGE_HEADER + worker.states.RecordWidth();
+  size_t backlog = 0;
+  while (batches) {
+    std::unique_ptr<Batch> batch(batches);
+    batches = batch->next;
+    for (size_t i = 0; i < batch->hashes.size(); i++) {
+      const uint16_t *message = &batch->values[i * width];
+      worker.states.Pack(message + MESSAGE_HEADER);
+      Offer(worker, batch->hashes[i], message[0], message[1],
+            message[2] | (StateId)message[3] << 16, message[4]);
+    }
+    backlog += batch->hashes.size();
+    pending--;
+  }
+  worker.stats.messagesReceived += backlog;
+  worker.stats.maxBacklog = std::max(worker.stats.maxBacklog, backlog);
+}
+
+void ParallelSolver::Offer(Worker &worker,
+                           uint64_t hash,
+                           int gValue,
+                           int hValue,
+                           StateId parent,
+                           uint16_t parentPush) {
+  StateStore &states = worker.states;
+  StateTableSlot *slot = worker.stateTable.Find(hash);
+  if (slot) {
+    StateId id = slot->id;
+    if (gValue >= states.GValue(id)) {
+      return;
+    }
+
+    // N.B., workers expand states out of global f-order, so closed states
+    // must always be re-opened when a cheaper path to them is found.
+    states.SetGValue(id, gValue);
+    states.SetParent(id, parent, StateStore::DecodePush(parentPush));
+    if (slot->status == StateStatus::CLOSED) {
+      slot->status = StateStatus::OPEN;
+      worker.openList->Push(id, gValue + hValue, gValue, hValue);
+    } else {
+      worker.openList->Update(id, gValue + hValue, gValue, hValue);
+    }
+    return;
+  }
+
+  StateId id = states.Add(worker.noPushes, gValue, hValue, false);
+  states.SetParent(id, parent, StateStore::DecodePush(parentPush));
+  worker.openList->Push(id, gValue + hValue, gValue, hValue);
+  worker.stateTable.Insert(hash, id, StateStatus::OPEN);
+}
+
+void ParallelSolver::Send(Worker &worker, int owner) {
+  Batch *batch = worker.outgoing[owner].release();
+  pending++;
+  std::atomic<Batch *> &mailbox = workers[owner]->mailbox;
+  batch->next = mailbox.load(std::memory_order_relaxed);
+  while (!mailbox.compare_exchange_weak(batch->next, batch,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed))
+    ;
+}
+
+void ParallelSolver::Flush(Worker &worker) {
+  for (int owner = 0; owner < worker.outgoing.size(); owner++) {
+    if (worker.outgoing[owner] && !worker.outgoing[owner]->hashes.empty()) {
+      Send(worker, owner);
+    }
+  }
+}
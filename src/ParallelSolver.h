@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Board.h"
+#include "SimpleDeadlockDetector.h"
+#include "SolveResult.h"
+#include "SolverOptions.h"
+#include "StateStore.h"
+
+// Hash-distributed parallel A* (HDA*). Every worker thread owns a copy of the
+// board and search components plus a shard of the open and closed sets. Each
+// generated state is routed to the worker owning its Zobrist hash through a
+// lock-free mailbox. Search continues after a solution is found until no
+// worker holds a state that could lead to a cheaper one, which preserves the
+// push-optimality of the serial solver.
+class ParallelSolver {
+public:
+  ParallelSolver(const Board &board, const SolverOptions &options);
+  ~ParallelSolver();
+
+  SolveResult Solve();
+
+private:
+  struct Batch;
+  struct Worker;
+
+  void Run(Worker &worker);
+  void Expand(Worker &worker, StateId id);
+  void Receive(Worker &worker, Batch *batches);
+  void Offer(Worker &worker,
+             uint64_t hash,
+             int gValue,
+             int hValue,
+             StateId parent,
+             uint16_t parentPush);
+  void Send(Worker &worker, int owner);
+  void Flush(Worker &worker);
+  int Owner(uint64_t hash) const;
+  StateId GlobalId(const Worker &worker, StateId id) const;
+
+  const Board &board;
+  SolverOptions options;
+  SimpleDeadlockDetector simpleDeadlockDetector;
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::atomic<int> statesVisited;
+  std::atomic<int> solutionPushes;
+  std::mutex solutionMutex;
+  int solutionWorker;
+  StateId solutionState;
+  std::atomic<long> pending;
+  std::atomic<bool> done;
+  std::atomic<bool> aborted;
+};
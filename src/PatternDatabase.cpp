@@ -0,0 +1,332 @@
+#include "PatternDatabase.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <deque>
+#include <stdexcept>
+
+#include "Checkpoint.h"
+
+using namespace std::string_literals;
+
+static const char MAGIC[8] = {'S', 'O', 'K', 'O', 'P', 'D', 'B', '1'};
+static const uint64_t VERSION = 1;
+
+// Maximum number of goals per group. N.B., tables hold a byte for every pair
+// of cells, so larger groups would need a sparser layout.
+static const int MAX_GROUP_SIZE = 2;
+
+// Table entry for box placements from which the group cannot be filled.
+// Longer distances are stored as MAX_DISTANCE, which remains a lower bound.
+static const uint8_t UNREACHED = 255;
+static const int MAX_DISTANCE = 254;
+
+// Upper bound on the number of search states per group.
+static const size_t MAX_GROUP_STATES = (size_t)1 << 30;
+
+struct PatternDatabaseHeader {
+  char magic[8];
+  uint64_t version;
+  uint64_t fingerprint;
+  int32_t boardSize;
+  int32_t cellCount;
+  int32_t groupCount;
+  int32_t padding;
+};
+
+namespace {
+
+// Retrograde search from a group's goals over placements of the group's
+// boxes alone on the board. States are the (sorted) box cells plus the player
+// cell. Player moves are free and pulls cost one push, so this is a 0-1
+// breadth-first search.
+class GroupSearch {
+public:
+  GroupSearch(const std::vector<int> &neighbors, int cellCount)
+      : neighbors(neighbors), cellCount(cellCount) {}
+
+  void Run(const std::vector<int> &goals, uint8_t *table) {
+    boxCount = goals.size();
+    size_t stateCount = cellCount;
+    for (int i = 0; i < boxCount; i++) {
+      stateCount *= cellCount;
+    }
+    if (stateCount > MAX_GROUP_STATES) {
+      throw std::length_error("level too large for pattern database");
+    }
+    distances.assign(stateCount, UNREACHED);
+    queue.clear();
+
+    // Start with the goals filled and the player anywhere.
+    std::copy(goals.begin(), goals.end(), boxes);
+    std::sort(boxes, boxes + boxCount);
+    for (int cell = 0; cell < cellCount; cell++) {
+      if (!IsBox(cell)) {
+        player = cell;
+        Visit(0, true);
+      }
+    }
+
+    while (!queue.empty()) {
+      size_t state = queue.front();
+      queue.pop_front();
+      Decode(state);
+      int distance = distances[state];
+      int original[MAX_GROUP_SIZE];
+      std::copy(boxes, boxes + boxCount, original);
+      int from = player;
+      for (int d = 0; d < 4; d++) {
+        int to = neighbors[from * 4 + d];
+        if (to == -1 || IsBox(to)) {
+          continue;
+        }
+
+        // Walk the player, pulling along the box behind it if any. N.B.,
+        // opposite directions differ in the lowest bit.
+        player = to;
+        Visit(distance, false);
+        int *box = std::find(boxes, boxes + boxCount,
+                             neighbors[from * 4 + (d ^ 1)]);
+        if (box != boxes + boxCount) {
+          *box = from;
+          std::sort(boxes, boxes + boxCount);
+          Visit(std::min(distance + 1, MAX_DISTANCE), true);
+          std::copy(original, original + boxCount, boxes);
+        }
+      }
+    }
+
+    // Keep the least distance over player cells.
+    for (size_t state = 0; state < distances.size(); state++) {
+      if (distances[state] == UNREACHED) {
+        continue;
+      }
+      Decode(state);
+      int first = boxes[0];
+      int second = boxCount > 1 ? boxes[1] : boxes[0];
+      for (size_t index : {(size_t)first * cellCount + second,
+                           (size_t)second * cellCount + first}) {
+        table[index] = std::min(table[index], distances[state]);
+      }
+    }
+  }
+
+private:
+  bool IsBox(int cell) const {
+    return std::find(boxes, boxes + boxCount, cell) != boxes + boxCount;
+  }
+
+  void Visit(int distance, bool isPull) {
+    size_t state = 0;
+    for (int i = 0; i < boxCount; i++) {
+      state = state * cellCount + boxes[i];
+    }
+    state = state * cellCount + player;
+    if (distance < distances[state]) {
+      distances[state] = distance;
+      if (isPull) {
+        queue.push_back(state);
+      } else {
+        queue.push_front(state);
+      }
+    }
+  }
+
+  void Decode(size_t state) {
+    player = state % cellCount;
+    state /= cellCount;
+    for (int i = boxCount - 1; i >= 0; i--) {
+      boxes[i] = state % cellCount;
+      state /= cellCount;
+    }
+  }
+
+  const std::vector<int> &neighbors;
+  int cellCount;
+  int boxCount;
+  int boxes[MAX_GROUP_SIZE];
+  int player;
+  std::vector<uint8_t> distances;
+  std::deque<size_t> queue;
+};
+
+} // namespace
+
+void PatternDatabase::Build(const Board &board, const std::string &path) {
+  // Use the board's dense index over open cells.
+  std::vector<int32_t> cellIndices(board.Size());
+  for (Position p = 0; p < board.Size(); p++) {
+    cellIndices[p] = board.CellIndex(p);
+  }
+  int cellCount = board.CellCount();
+  std::vector<int> neighbors(cellCount * 4);
+  for (int cell = 0; cell < cellCount; cell++) {
+    for (Direction d : ALL_DIRECTIONS) {
+      Position p = board.MovePosition(board.Cell(cell), d);
+      neighbors[cell * 4 + (int)d] = board.CellIndex(p);
+    }
+  }
+
+  // Group each goal with its nearest ungrouped goal, since nearby goals are
+  // the ones most likely to interfere with each other.
+  int goalCount = board.Goals().size();
+  std::vector<std::vector<int>> groups;
+  std::vector<bool> grouped(goalCount, false);
+  std::vector<int> goalDistances(cellCount);
+  for (int i = 0; i < goalCount; i++) {
+    if (grouped[i]) {
+      continue;
+    }
+    grouped[i] = true;
+    int goal = cellIndices[board.Goals()[i]];
+    std::fill(goalDistances.begin(), goalDistances.end(), -1);
+    std::vector<int> queue = {goal};
+    goalDistances[goal] = 0;
+    for (int head = 0; head < queue.size(); head++) {
+      for (int d = 0; d < 4; d++) {
+        int next = neighbors[queue[head] * 4 + d];
+        if (next != -1 && goalDistances[next] == -1) {
+          goalDistances[next] = goalDistances[queue[head]] + 1;
+          queue.push_back(next);
+        }
+      }
+    }
+    int nearest = -1;
+    int nearestDistance = -1;
+    for (int j = i + 1; j < goalCount; j++) {
+      int distance = goalDistances[cellIndices[board.Goals()[j]]];
+      if (!grouped[j] && distance != -1 &&
+          (nearest == -1 || distance < nearestDistance)) {
+        nearest = j;
+        nearestDistance = distance;
+      }
+    }
+    groups.push_back({goal});
+    if (nearest != -1) {
+      grouped[nearest] = true;
+      groups.back().push_back(cellIndices[board.Goals()[nearest]]);
+    }
+  }
+
+  // Search each group.
+  size_t tableSize = (size_t)cellCount * cellCount;
+  std::vector<uint8_t> tables(tableSize * groups.size(), UNREACHED);
+  std::vector<int32_t> groupSizes;
+  GroupSearch search(neighbors, cellCount);
+  for (int i = 0; i < groups.size(); i++) {
+    search.Run(groups[i], &tables[tableSize * i]);
+    groupSizes.push_back(groups[i].size());
+  }
+
+  // Write the database.
+  PatternDatabaseHeader header = {};
+  std::copy(MAGIC, MAGIC + sizeof(MAGIC), header.magic);
+  header.version = VERSION;
+  header.fingerprint = ComputeFingerprint(board);
+  header.boardSize = board.Size();
+  header.cellCount = cellCount;
+  header.groupCount = groups.size();
+  FILE *file = fopen(path.c_str(), "wb");
+  if (!file) {
+    throw std::runtime_error("cannot write pattern database: "s + path);
+  }
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+            fwrite(cellIndices.data(), sizeof(int32_t), cellIndices.size(),
+                   file) == cellIndices.size() &&
+            fwrite(groupSizes.data(), sizeof(int32_t), groupSizes.size(),
+                   file) == groupSizes.size() &&
+            fwrite(tables.data(), 1, tables.size(), file) == tables.size();
+  if (fclose(file) != 0 || !ok) {
+    remove(path.c_str());
+    throw std::runtime_error("error writing pattern database: "s + path);
+  }
+}
+
+PatternDatabase::PatternDatabase(const Board &board, const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    throw std::runtime_error("cannot read pattern database: "s + path);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < sizeof(PatternDatabaseHeader)) {
+    close(fd);
+    throw std::runtime_error("bad pattern database: "s + path);
+  }
+  fileSize = st.st_size;
+  mapping = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error("cannot map pattern database: "s + path);
+  }
+  madvise(mapping, fileSize, MADV_RANDOM);
+
+  auto fail = [&](const std::string &message) {
+    munmap(mapping, fileSize);
+    throw std::runtime_error(message + path);
+  };
+  const PatternDatabaseHeader *header =
+      static_cast<const PatternDatabaseHeader *>(mapping);
+  if (!std::equal(MAGIC, MAGIC + sizeof(MAGIC), header->magic) ||
+      header->version != VERSION) {
+    fail("bad pattern database: ");
+  }
+  if (header->fingerprint != ComputeFingerprint(board) ||
+      header->boardSize != board.Size()) {
+    fail("pattern database is for a different level: ");
+  }
+  cellCount = header->cellCount;
+  groupCount = header->groupCount;
+  size_t expectedSize =
+      sizeof(PatternDatabaseHeader) +
+      ((size_t)header->boardSize + groupCount) * sizeof(int32_t) +
+      (size_t)cellCount * cellCount * groupCount;
+  if (fileSize != expectedSize) {
+    fail("truncated pattern database: ");
+  }
+  cellIndices = reinterpret_cast<const int32_t *>(header + 1);
+  groupSizes = cellIndices + header->boardSize;
+  tables = reinterpret_cast<const uint8_t *>(groupSizes + groupCount);
+}
+
+PatternDatabase::~PatternDatabase() { munmap(mapping, fileSize); }
+
+const uint8_t *PatternDatabase::Table(int group) const {
+  return tables + (size_t)cellCount * cellCount * group;
+}
+
+int PatternDatabase::EstimateDistance(const std::vector<Position> &boxes) const {
+  int n = boxes.size();
+  for (int i = 0; i < n; i++) {
+    assert(cellIndices[boxes[i]] != -1);
+  }
+
+  int totalDistance = 0;
+  for (int group = 0; group < groupCount; group++) {
+    const uint8_t *table = Table(group);
+    uint8_t best = UNREACHED;
+    if (groupSizes[group] == 1) {
+      for (int i = 0; i < n; i++) {
+        size_t cell = cellIndices[boxes[i]];
+        best = std::min(best, table[cell * (cellCount + 1)]);
+      }
+    } else {
+      for (int i = 0; i < n; i++) {
+        const uint8_t *row = table + (size_t)cellIndices[boxes[i]] * cellCount;
+        for (int j = i + 1; j < n; j++) {
+          best = std::min(best, row[cellIndices[boxes[j]]]);
+        }
+      }
+    }
+    if (best == UNREACHED) {
+      return -1;
+    }
+    totalDistance += best;
+  }
+  return totalDistance;
+}
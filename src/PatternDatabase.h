@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Board.h"
+
+// Disjoint pattern database over goal groups. Goals are partitioned into
+// groups of up to two nearby goals, and for each group the database holds
+// the pushes needed to move each set of boxes onto the group's goals with all
+// other boxes removed, as found by a retrograde search from the goals.
+//
+// The database is built offline with Build() and memory-mapped when loaded,
+// so that loading costs nothing up front. Databases are keyed by the level's
+// fingerprint and are rejected for any other level.
+class PatternDatabase {
+public:
+  PatternDatabase(const Board &board, const std::string &path);
+  ~PatternDatabase();
+
+  PatternDatabase(const PatternDatabase &) = delete;
+  PatternDatabase &operator=(const PatternDatabase &) = delete;
+
+  // Builds the database for the board and writes it to the given file.
+  static void Build(const Board &board, const std::string &path);
+
+  // Estimates the pushes needed to move the boxes onto goals, or returns -1
+  // if some goal group cannot be filled. N.B., boxes solving one group are
+  // found independently of the other groups; this keeps the sum over groups
+  // admissible, since each box is pushed onto at most one group's goals.
+  int EstimateDistance(const std::vector<Position> &boxes) const;
+
+  int GroupCount() const { return groupCount; }
+  size_t FileSize() const { return fileSize; }
+
+private:
+  const uint8_t *Table(int group) const;
+
+  int cellCount;
+  int groupCount;
+  const int32_t *cellIndices;
+  const int32_t *groupSizes;
+  const uint8_t *tables;
+  void *mapping;
+  size_t fileSize;
+};
@@ -3,27 +3,74 @@
 #include "PushSearcher.h"
 
 PushSearcher::PushSearcher(const Board &board,
-                           const SimpleDeadlockDetector &simpleDeadlockDetector)
+                           const SimpleDeadlockDetector &simpleDeadlockDetector,
+                           CorralDeadlockDetector *corralDeadlockDetector,
+                           Reachability reachability)
     : board(board),
       simpleDeadlockDetector(simpleDeadlockDetector),
-      playerVisited(board.Size(), false),
-      pushesVisited(board.Size() * 4, false),
-      corralVisited(board.Size(), false),
-      corralPushVisited(board.Size(), false),
-      corralEdgeBoxes(board.Size(), false) {}
+      corralDeadlockDetector(corralDeadlockDetector),
+      playerVisited(board.Size()),
+      pushesVisited(board.Size() * 4),
+      corralVisited(board.Size()),
+      corralPushVisited(board.Size()),
+      corralEdgeBoxes(board.Size()),
+      tunnels(board.Size() * 4, false) {
+  // A box is in a tunnel when it and the player pushing it are both walled in
+  // on either side, so that the player can only push it on or back off. N.B.,
+  // boxes are never stopped on a goal.
+  auto isInterior = [&](Position p) {
+    return board.PositionX(p) > 0 && board.PositionX(p) < board.Width() - 1 &&
+           board.PositionY(p) > 0 && board.PositionY(p) < board.Height() - 1 &&
+           !board.HasWall(p);
+  };
+  for (Position p = 0; p < board.Size(); p++) {
+    if (!isInterior(p) || board.HasGoal(p)) {
+      continue;
+    }
+    for (Direction d : ALL_DIRECTIONS) {
+      Position player = board.UnmovePosition(p, d);
+      if (!isInterior(player)) {
+        continue;
+      }
+      // N.B., perpendicular directions differ in the second bit.
+      bool walled = true;
+      for (Direction side : ALL_DIRECTIONS) {
+        if (((int)side >> 1) != ((int)d >> 1)) {
+          walled = walled && board.HasWall(board.MovePosition(p, side)) &&
+                   board.HasWall(board.MovePosition(player, side));
+        }
+      }
+      tunnels[p * 4 + (int)d] = walled;
+    }
+  }
+  if (reachability == Reachability::BITBOARD) {
+    bitBoard.emplace(board);
+  }
+}
 
 PushSearchResult PushSearcher::FindPushes(std::vector<Push> &pushes) {
   Position normPlayer = FindUnprunedPushes(pushes);
-  bool isPICorral = PruneCorrals(pushes);
+  bool isCorralDeadlock = false;
+  bool isPICorral = PruneCorrals(pushes, isCorralDeadlock);
   PruneSimpleDeadlocks(pushes);
-  return PushSearchResult(normPlayer, isPICorral);
+  PushSearchResult result(normPlayer, isPICorral);
+  result.isCorralDeadlock = isCorralDeadlock;
+  return result;
+}
+
+Position PushSearcher::FindNormalizedPlayer() {
+  return FindUnprunedPushes(unprunedPushes);
 }
 
 Position PushSearcher::FindUnprunedPushes(std::vector<Push> &pushes) {
+  if (bitBoard) {
+    return bitBoard->FindPushes(pushes);
+  }
+
   // Initialize input data structures.
   pushes.clear();
-  std::fill(playerVisited.begin(), playerVisited.end(), false);
-  std::fill(pushesVisited.begin(), pushesVisited.end(), false);
+  playerVisited.Clear();
+  pushesVisited.Clear();
   stack.clear();
   stack.push_back(board.Player());
 
@@ -32,13 +79,13 @@ Position PushSearcher::FindUnprunedPushes(std::vector<Push> &pushes) {
   while (!stack.empty()) {
     Position p = stack.back();
     stack.pop_back();
-    if (playerVisited[p]) {
+    if (playerVisited.Contains(p)) {
       continue;
     }
-    playerVisited[p] = true;
+    playerVisited.Insert(p);
     for (Direction d : ALL_DIRECTIONS) {
       Position p2 = board.MovePosition(p, d);
-      if (playerVisited[p2]) {
+      if (playerVisited.Contains(p2)) {
         continue;
       }
       if (board.HasWall(p2)) {
@@ -47,7 +94,7 @@ Position PushSearcher::FindUnprunedPushes(std::vector<Push> &pushes) {
       if (board.HasBox(p2)) {
         Position p3 = board.MovePosition(p2, d);
         if (!board.HasBox(p3) && !board.HasWall(p3)) {
-          pushesVisited[(int)d * board.Size() + p2] = true;
+          pushesVisited.Insert((int)d * board.Size() + p2);
           pushes.emplace_back(p2, d);
         }
         continue;
@@ -62,20 +109,78 @@ Position PushSearcher::FindUnprunedPushes(std::vector<Push> &pushes) {
   return normPlayer;
 }
 
-bool PushSearcher::PruneCorrals(std::vector<Push> &pushes) {
-  std::fill(corralVisited.begin(), corralVisited.end(), false);
+int PushSearcher::TunnelLength(const Push &push) const {
+  Direction d = push.Direction();
+  Position box = board.MovePosition(push.Box(), d);
+  int length = 1;
+  while (tunnels[box * 4 + (int)d]) {
+    Position next = board.MovePosition(box, d);
+    if (board.HasWall(next) || board.HasBox(next) ||
+        simpleDeadlockDetector.IsDeadlock(next)) {
+      break;
+    }
+    box = next;
+    length++;
+  }
+  return length;
+}
+
+Position PushSearcher::FindPulls(std::vector<Push> &pulls) {
+  // Initialize input data structures.
+  pulls.clear();
+  playerVisited.Clear();
+  stack.clear();
+  stack.push_back(board.Player());
+
+  // Perform DFS. A pull is possible whenever the player stands next to a box
+  // and has room to step back away from it.
+  Position normPlayer = board.Player();
+  while (!stack.empty()) {
+    Position p = stack.back();
+    stack.pop_back();
+    if (playerVisited.Contains(p)) {
+      continue;
+    }
+    playerVisited.Insert(p);
+    if (p < normPlayer) {
+      normPlayer = p;
+    }
+    for (Direction d : ALL_DIRECTIONS) {
+      Position p2 = board.MovePosition(p, d);
+      if (board.HasWall(p2)) {
+        continue;
+      }
+      if (board.HasBox(p2)) {
+        Position back = board.UnmovePosition(p, d);
+        if (!board.HasBox(back) && !board.HasWall(back)) {
+          pulls.emplace_back(p, d);
+        }
+        continue;
+      }
+      if (!playerVisited.Contains(p2)) {
+        stack.push_back(p2);
+      }
+    }
+  }
+
+  return normPlayer;
+}
+
+bool PushSearcher::PruneCorrals(std::vector<Push> &pushes,
+                                bool &isCorralDeadlock) {
+  corralVisited.Clear();
 
   for (const Push &push : pushes) {
     Position pushTo = board.MovePosition(push.Box(), push.Direction());
 
     // If push into player visited region, this is not a corral.
-    if (playerVisited[pushTo]) {
+    if (IsReached(pushTo)) {
       continue;
     }
 
     // Otherwise this push leads to a corral.
     // If we've already processed this corral, then we can skip.
-    if (corralVisited[pushTo]) {
+    if (corralVisited.Contains(pushTo)) {
       continue;
     }
 
@@ -83,26 +188,32 @@ bool PushSearcher::PruneCorrals(std::vector<Push> &pushes) {
     // N.B., unlike "corralVisited", "corralEdgeBoxes" is cleared every time we
     // do a DFS since any given box may belong to multiple corrals.
     bool foundNonGoalCorralEdgeBox = false;
-    std::fill(corralEdgeBoxes.begin(), corralEdgeBoxes.end(), false);
+    corralEdgeBoxes.Clear();
+    corralCells.clear();
+    corralBoxes.clear();
     stack.clear();
     stack.push_back(pushTo);
     while (!stack.empty()) {
       Position p = stack.back();
       stack.pop_back();
-      if (corralVisited[p]) {
+      if (corralVisited.Contains(p)) {
         continue;
       }
-      corralVisited[p] = true;
+      corralVisited.Insert(p);
+      corralCells.push_back(p);
       for (Direction d : ALL_DIRECTIONS) {
         Position p2 = board.MovePosition(p, d);
-        if (corralVisited[p2]) {
+        if (corralVisited.Contains(p2)) {
           continue;
         }
         if (board.HasWall(p2)) {
           continue;
         }
         if (board.HasBox(p2)) {
-          corralEdgeBoxes[p2] = true;
+          if (!corralEdgeBoxes.Contains(p2)) {
+            corralBoxes.push_back(p2);
+          }
+          corralEdgeBoxes.Insert(p2);
           if (!board.HasGoal(p2)) {
             foundNonGoalCorralEdgeBox = true;
           }
@@ -123,34 +234,33 @@ bool PushSearcher::PruneCorrals(std::vector<Push> &pushes) {
     // 1. All corral edge box pushes land inside the corral, and
     // 2. All corral edge box pushes can be made currently by the player.
     // If these conditions hold, we may use the corral for pruning.
-    std::fill(corralPushVisited.begin(), corralPushVisited.end(), false);
+    corralPushVisited.Clear();
     bool isPrunableCorral = true;
     stack.clear();
     stack.push_back(board.Player());
     while (!stack.empty()) {
       Position p = stack.back();
       stack.pop_back();
-      if (corralPushVisited[p]) {
+      if (corralPushVisited.Contains(p)) {
         continue;
       }
-      corralPushVisited[p] = true;
+      corralPushVisited.Insert(p);
       for (Direction d : ALL_DIRECTIONS) {
         Position p2 = board.MovePosition(p, d);
-        if (corralPushVisited[p2]) {
+        if (corralPushVisited.Contains(p2)) {
           continue;
         }
         if (board.HasWall(p2)) {
           continue;
         }
-        if (corralEdgeBoxes[p2]) {
+        if (corralEdgeBoxes.Contains(p2)) {
           Position p3 = board.MovePosition(p2, d);
-          if (!corralEdgeBoxes[p3] && !board.HasWall(p3)) {
+          if (!corralEdgeBoxes.Contains(p3) && !board.HasWall(p3)) {
             // This is a valid push --- we need to check two conditions:
             // 1. If the push lands outside the corral, or
             // 2. If the player cannot make the push.
             // In either case we know this corral cannot be used for pruning.
-            if (!corralVisited[p3] ||
-                !pushesVisited[(int)d * board.Size() + p2]) {
+            if (!corralVisited.Contains(p3) || !IsPushable(p2, d)) {
               isPrunableCorral = false;
               goto exit_dfs;
             }
@@ -163,9 +273,13 @@ bool PushSearcher::PruneCorrals(std::vector<Push> &pushes) {
   exit_dfs:
 
     if (isPrunableCorral) {
+      if (corralDeadlockDetector) {
+        isCorralDeadlock =
+            corralDeadlockDetector->IsDeadlock(corralCells, corralBoxes);
+      }
       int i = 0;
       while (i < pushes.size()) {
-        if (!corralEdgeBoxes[pushes[i].Box()]) {
+        if (!corralEdgeBoxes.Contains(pushes[i].Box())) {
           pushes[i] = pushes.back();
           pushes.pop_back();
         } else {
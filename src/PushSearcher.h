@@ -1,13 +1,21 @@
 #pragma once
 
+#include <optional>
 #include <vector>
 
+#include "BitBoard.h"
 #include "Board.h"
+#include "CorralDeadlockDetector.h"
+#include "ScratchSet.h"
 #include "SimpleDeadlockDetector.h"
 
+// How the player's reachable cells are found when generating pushes.
+enum class Reachability { DFS, BITBOARD };
+
 struct PushSearchResult {
   Position normalizedPlayer;
   bool isPICorral;
+  bool isCorralDeadlock = false;
 
   PushSearchResult(Position normalizedPlayer, bool isPICorral)
       : normalizedPlayer(normalizedPlayer), isPICorral(isPICorral) {}
@@ -15,22 +23,50 @@ struct PushSearchResult {
 
 class PushSearcher {
 public:
+  // If a corral deadlock detector is given, the PI-corrals found are also
+  // checked for deadlocks.
   PushSearcher(const Board &board,
-               const SimpleDeadlockDetector &simpleDeadlockDetector);
+               const SimpleDeadlockDetector &simpleDeadlockDetector,
+               CorralDeadlockDetector *corralDeadlockDetector = nullptr,
+               Reachability reachability = Reachability::DFS);
 
   PushSearchResult FindPushes(std::vector<Push> &pushes);
+  Position FindNormalizedPlayer();
+
+  // Returns the number of pushes in the tunnel macro starting with the given
+  // push: once a box is pushed into a tunnel, it is pushed on until it leaves
+  // the tunnel, reaches a goal, or is blocked.
+  int TunnelLength(const Push &push) const;
+
+  // Finds all legal pulls, for searching backwards from solved states. Each
+  // pull is expressed as the push it undoes (see Board::PerformUnpush).
+  Position FindPulls(std::vector<Push> &pulls);
 
 private:
   Position FindUnprunedPushes(std::vector<Push> &pushes);
-  bool PruneCorrals(std::vector<Push> &pushes);
+  bool PruneCorrals(std::vector<Push> &pushes, bool &isCorralDeadlock);
   void PruneSimpleDeadlocks(std::vector<Push> &pushes);
 
+  bool IsReached(Position p) const {
+    return bitBoard ? bitBoard->IsReached(p) : playerVisited.Contains(p);
+  }
+  bool IsPushable(Position box, Direction d) const {
+    return bitBoard ? bitBoard->IsPushable(box, d)
+                    : pushesVisited.Contains((int)d * board.Size() + box);
+  }
+
   const Board &board;
   const SimpleDeadlockDetector &simpleDeadlockDetector;
+  CorralDeadlockDetector *corralDeadlockDetector;
+  std::optional<BitBoard> bitBoard;
   std::vector<Position> stack;
-  std::vector<bool> pushesVisited;
-  std::vector<bool> playerVisited;
-  std::vector<bool> corralVisited;
-  std::vector<bool> corralPushVisited;
-  std::vector<bool> corralEdgeBoxes;
+  std::vector<Push> unprunedPushes;
+  ScratchSet pushesVisited;
+  ScratchSet playerVisited;
+  ScratchSet corralVisited;
+  ScratchSet corralPushVisited;
+  ScratchSet corralEdgeBoxes;
+  std::vector<bool> tunnels;
+  std::vector<Position> corralCells;
+  std::vector<Position> corralBoxes;
 };
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Set of small indices (e.g., board positions) which can be cleared in O(1),
+// for visited flags that would otherwise be cleared on every call. Each
+// entry is stamped with the epoch in which it was inserted, and clearing
+// starts a new epoch.
+class ScratchSet {
+public:
+  ScratchSet(size_t size) : stamps(size, 0), epoch(1) {}
+
+  void Clear() {
+    // N.B., stamps are only reset when the epoch wraps around.
+    if (++epoch == 0) {
+      std::fill(stamps.begin(), stamps.end(), 0);
+      epoch = 1;
+    }
+  }
+
+  bool Contains(size_t i) const { return stamps[i] == epoch; }
+  void Insert(size_t i) { stamps[i] = epoch; }
+
+private:
+  std::vector<uint32_t> stamps;
+  uint32_t epoch;
+};
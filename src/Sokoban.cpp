@@ -8,11 +8,65 @@
 #include <utility>
 #include <vector>
 
+#include "BidirectionalSolver.h"
 #include "Board.h"
+#include "Checkpoint.h"
+#include "IdaSolver.h"
+#include "ParallelSolver.h"
+#include "PatternDatabase.h"
 #include "Solver.h"
 
 using namespace std::string_literals;
 
+static TieBreak ParseTieBreak(const std::string &name) {
+  if (name == "deepest-g") {
+    return TieBreak::DEEPEST_G;
+  } else if (name == "lowest-h") {
+    return TieBreak::LOWEST_H;
+  } else if (name == "lifo") {
+    return TieBreak::LIFO;
+  }
+  throw std::invalid_argument("bad tie-break policy: "s + name);
+}
+
+static Algorithm ParseAlgorithm(const std::string &name) {
+  if (name == "astar") {
+    return Algorithm::ASTAR;
+  } else if (name == "ida") {
+    return Algorithm::IDASTAR;
+  } else if (name == "bidir") {
+    return Algorithm::BIDIRECTIONAL;
+  }
+  throw std::invalid_argument("bad algorithm: "s + name);
+}
+
+static Heuristic ParseHeuristic(const std::string &name) {
+  if (name == "greedy") {
+    return Heuristic::GREEDY;
+  } else if (name == "matching") {
+    return Heuristic::MATCHING;
+  }
+  throw std::invalid_argument("bad heuristic: "s + name);
+}
+
+static OpenListType ParseOpenListType(const std::string &name) {
+  if (name == "bucket") {
+    return OpenListType::BUCKET;
+  } else if (name == "heap") {
+    return OpenListType::HEAP;
+  }
+  throw std::invalid_argument("bad open list type: "s + name);
+}
+
+static Reachability ParseReachability(const std::string &name) {
+  if (name == "dfs") {
+    return Reachability::DFS;
+  } else if (name == "bitboard") {
+    return Reachability::BITBOARD;
+  }
+  throw std::invalid_argument("bad reachability: "s + name);
+}
+
 int main(int argc, char *argv[]) {
   // Parse arguments.
   argparse::ArgumentParser program("Sokoban");
@@ -26,6 +80,82 @@ int main(int argc, char *argv[]) {
       .help("maximum number of states to limit search to")
       .default_value(1000000)
       .scan<'i', int>();
+  program.add_argument("--max-memory")
+      .help("memory budget for the search in MB (0 for none)")
+      .default_value(0)
+      .scan<'i', int>();
+  program.add_argument("-l", "--lazy-pushes")
+      .help("regenerate pushes on expansion instead of storing them")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--tie-break")
+      .help("tie-breaking policy for equal f-values (deepest-g|lowest-h|lifo)")
+      .default_value("deepest-g"s);
+  program.add_argument("--open-list")
+      .help("open list implementation (bucket|heap)")
+      .default_value("bucket"s);
+  program.add_argument("--reachability")
+      .help("player reachability for push generation (dfs|bitboard)")
+      .default_value("dfs"s);
+  program.add_argument("--tunnel-macros")
+      .help("push boxes through tunnels in a single step")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--goal-room-macros")
+      .help("push boxes entering a goal room straight onto its next goal")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--symmetry")
+      .help("search symmetric states of symmetric levels only once")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--reopen-closed")
+      .help("re-open closed states when a cheaper path is found")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--heuristic")
+      .help("distance heuristic (greedy|matching)")
+      .default_value("greedy"s);
+  program.add_argument("--pdb")
+      .help("pattern database file to combine with the heuristic");
+  program.add_argument("--build-pdb")
+      .help("build a pattern database for the level into the file and exit");
+  program.add_argument("--learn-deadlocks")
+      .help("learn deadlock patterns with sub-searches during search")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--deadlock-db")
+      .help("file to load and save learned deadlock patterns (implies "
+            "--learn-deadlocks)");
+  program.add_argument("-w", "--weight")
+      .help("weight of h-values for weighted A*")
+      .default_value(1.0)
+      .scan<'g', double>();
+  program.add_argument("--anytime")
+      .help("keep improving solutions with decreasing weights")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("-a", "--algorithm")
+      .help("search algorithm (astar|ida|bidir)")
+      .default_value("astar"s);
+  program.add_argument("--tt-size")
+      .help("IDA* transposition table size in MB")
+      .default_value(64)
+      .scan<'i', int>();
+  program.add_argument("--checkpoint")
+      .help("checkpoint file for unfinished searches");
+  program.add_argument("--checkpoint-interval")
+      .help("minimum number of seconds between checkpoints")
+      .default_value(600)
+      .scan<'i', int>();
+  program.add_argument("--resume")
+      .help("resume the search from the checkpoint file")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("-j", "--threads")
+      .help("number of worker threads for parallel search")
+      .default_value(1)
+      .scan<'i', int>();
   try {
     program.parse_args(argc, argv);
   } catch (const std::runtime_error &err) {
@@ -44,6 +174,21 @@ int main(int argc, char *argv[]) {
     Board board = Board::ParseFromText(levelFile);
     levelFile.close();
 
+    // Build the pattern database if requested.
+    if (program.present("--build-pdb")) {
+      auto timeStart = std::chrono::system_clock::now();
+      std::string path = program.get("--build-pdb");
+      PatternDatabase::Build(board, path);
+      PatternDatabase patternDatabase(board, path);
+      auto timeEnd = std::chrono::system_clock::now();
+      std::chrono::duration<double, std::milli> elapsed = timeEnd - timeStart;
+      std::cout << "groups: " << patternDatabase.GroupCount() << std::endl;
+      std::cout << "size: " << patternDatabase.FileSize() / (1024.0 * 1024.0)
+                << " MB" << std::endl;
+      std::cout << "elapsed: " << elapsed.count() << " ms" << std::endl;
+      return 0;
+    }
+
     // Open the graph output if present.
     std::unique_ptr<std::ofstream> debugFile;
     if (program.present("-d")) {
@@ -55,10 +200,122 @@ int main(int argc, char *argv[]) {
 
     // Run the solver.
     auto timeStart = std::chrono::system_clock::now();
-    Solver solver(board, program.get<int>("-m"));
-    SolveResult result = solver.Solve(debugFile.get());
+    SolverOptions options;
+    options.maxStates = program.get<int>("-m");
+    options.maxMemoryBytes = (size_t)program.get<int>("--max-memory") << 20;
+    options.lazyPushes = program.get<bool>("-l");
+    options.tieBreak = ParseTieBreak(program.get("--tie-break"));
+    options.openList = ParseOpenListType(program.get("--open-list"));
+    options.reopenClosed = program.get<bool>("--reopen-closed");
+    options.tunnelMacros = program.get<bool>("--tunnel-macros");
+    options.goalRoomMacros = program.get<bool>("--goal-room-macros");
+    options.symmetry = program.get<bool>("--symmetry");
+    options.heuristic = ParseHeuristic(program.get("--heuristic"));
+    options.reachability = ParseReachability(program.get("--reachability"));
+    std::unique_ptr<PatternDatabase> patternDatabase;
+    if (program.present("--pdb")) {
+      patternDatabase.reset(new PatternDatabase(board, program.get("--pdb")));
+      options.patternDatabase = patternDatabase.get();
+    }
+    options.learnDeadlocks = program.get<bool>("--learn-deadlocks");
+    if (program.present("--deadlock-db")) {
+      options.learnDeadlocks = true;
+      options.deadlockDatabasePath = program.get("--deadlock-db");
+    }
+    options.weight = program.get<double>("-w");
+    options.anytime = program.get<bool>("--anytime");
+    options.algorithm = ParseAlgorithm(program.get("-a"));
+    options.transpositionTableBytes = (size_t)program.get<int>("--tt-size")
+                                      << 20;
+    options.threads = program.get<int>("-j");
+    if (options.threads < 1) {
+      throw std::invalid_argument("bad thread count: "s +
+                                  std::to_string(options.threads));
+    }
+    if (options.threads > 1 && options.algorithm != Algorithm::ASTAR) {
+      throw std::invalid_argument("parallel search requires A*");
+    }
+    if (options.weight < 1) {
+      throw std::invalid_argument("bad weight: "s +
+                                  std::to_string(options.weight));
+    }
+    if (options.anytime && options.weight == 1) {
+      throw std::invalid_argument("anytime search requires a weight above 1");
+    }
+    if (options.threads > 1 && options.reopenClosed) {
+      // N.B., parallel search always re-opens closed states, as workers
+      // expand states out of global f-order.
+      throw std::invalid_argument(
+          "re-opening closed states is implied by parallel search");
+    }
+    if (options.symmetry && options.goalRoomMacros) {
+      // N.B., the packing order of a symmetric goal room is not symmetric.
+      throw std::invalid_argument(
+          "symmetry cannot be combined with goal room macros");
+    }
+
+    // Options only supported by single-threaded A*. N.B., parallel search
+    // never stores pushes, so lazy pushes are implied there.
+    bool serialAStar =
+        options.threads == 1 && options.algorithm == Algorithm::ASTAR;
+    std::vector<std::pair<std::string, bool>> serialAStarOptions = {
+        {"-d", debugFile != nullptr},
+        {"-w", options.weight > 1},
+        {"--anytime", options.anytime},
+        {"--lazy-pushes", options.lazyPushes},
+        {"--max-memory", options.maxMemoryBytes > 0},
+        {"--tunnel-macros", options.tunnelMacros},
+        {"--goal-room-macros", options.goalRoomMacros},
+        {"--symmetry", options.symmetry},
+        {"--learn-deadlocks", options.learnDeadlocks},
+        {"--checkpoint", program.present("--checkpoint").has_value()},
+    };
+    for (const auto &[name, enabled] : serialAStarOptions) {
+      if (enabled && !serialAStar) {
+        throw std::invalid_argument(name + " requires single-threaded A*");
+      }
+    }
+
+    // Options only supported by the best-first searches. N.B., IDA* keeps no
+    // open list and never closes states.
+    std::vector<std::pair<std::string, bool>> bestFirstOptions = {
+        {"--open-list", program.is_used("--open-list")},
+        {"--tie-break", program.is_used("--tie-break")},
+        {"--reopen-closed", options.reopenClosed},
+    };
+    for (const auto &[name, enabled] : bestFirstOptions) {
+      if (enabled && options.algorithm == Algorithm::IDASTAR) {
+        throw std::invalid_argument(name + " requires A* or bidirectional "
+                                           "search");
+      }
+    }
+
+    if (program.present("--checkpoint")) {
+      options.checkpointPath = program.get("--checkpoint");
+      options.checkpointInterval = program.get<int>("--checkpoint-interval");
+      options.resume = program.get<bool>("--resume");
+      InstallTerminationHandler();
+    } else if (program.get<bool>("--resume")) {
+      throw std::invalid_argument("resume requires a checkpoint file");
+    }
+    SolveResult result(false, 0, -1, 0);
+    if (options.algorithm == Algorithm::IDASTAR) {
+      IdaSolver solver(board, options);
+      result = solver.Solve();
+    } else if (options.algorithm == Algorithm::BIDIRECTIONAL) {
+      BidirectionalSolver solver(board, options);
+      result = solver.Solve();
+    } else if (options.threads > 1) {
+      ParallelSolver solver(board, options);
+      result = solver.Solve();
+    } else {
+      Solver solver(board, options);
+      result = solver.Solve(debugFile.get());
+    }
     auto timeEnd = std::chrono::system_clock::now();
     std::chrono::duration<double, std::milli> elapsed = timeEnd - timeStart;
+    double memoryMB = result.memoryUsed / (1024.0 * 1024.0);
+    double statesPerSecond = result.statesVisited / (elapsed.count() / 1000.0);
 
     // Output results.
     if (program["-t"] == true) {
@@ -66,13 +323,58 @@ int main(int argc, char *argv[]) {
       std::cout << (result.solved ? "true" : "false") << '\t';
       std::cout << result.statesVisited << '\t';
       std::cout << result.pushesRequired << '\t';
-      std::cout << elapsed.count() << " ms" << std::endl;
+      std::cout << elapsed.count() << " ms" << '\t';
+      std::cout << memoryMB << " MB" << '\t';
+      std::cout << statesPerSecond << " states/s" << std::endl;
     } else {
       std::cout << "solved: " << (result.solved ? "true" : "false")
                 << std::endl;
       std::cout << "states: " << result.statesVisited << std::endl;
       std::cout << "pushes: " << result.pushesRequired << std::endl;
       std::cout << "elapsed: " << elapsed.count() << " ms" << std::endl;
+      std::cout << "memory: " << memoryMB << " MB" << std::endl;
+      std::cout << "rate: " << statesPerSecond << " states/s" << std::endl;
+      if (result.suboptimalityBound) {
+        std::cout << "bound: " << *result.suboptimalityBound << std::endl;
+      }
+      if (options.anytime) {
+        for (const AnytimeIteration &iteration : result.iterations) {
+          std::cout << "weight " << iteration.weight << ": pushes "
+                    << iteration.pushesRequired << " after "
+                    << iteration.statesVisited << " states" << std::endl;
+        }
+      }
+      if (result.interrupted) {
+        std::cout << "interrupted: true" << std::endl;
+      }
+      if (options.algorithm == Algorithm::ASTAR) {
+        std::cout << "bipartite deadlocks: " << result.bipartiteDeadlocks
+                  << std::endl;
+        std::cout << "corral deadlocks: " << result.corralDeadlocks
+                  << std::endl;
+      }
+      if (options.symmetry) {
+        std::cout << "symmetric transpositions: "
+                  << result.symmetricTranspositions << std::endl;
+      }
+      if (options.learnDeadlocks) {
+        std::cout << "deadlock patterns: " << result.deadlockPatterns
+                  << std::endl;
+      }
+      if (options.maxMemoryBytes > 0) {
+        std::cout << "evicted: " << result.statesEvicted << std::endl;
+        std::cout << "memory exhausted: "
+                  << (result.memoryExhausted ? "true" : "false") << std::endl;
+      }
+      if (result.solved) {
+        std::cout << "solution: " << result.solution << std::endl;
+      }
+      for (int i = 0; i < result.workerStats.size(); i++) {
+        const WorkerStats &stats = result.workerStats[i];
+        std::cout << "thread " << i << ": states " << stats.statesVisited
+                  << ", messages " << stats.messagesReceived
+                  << ", max backlog " << stats.maxBacklog << std::endl;
+      }
     }
 
   } catch (const std::exception &e) {
@@ -0,0 +1,60 @@
+#include "Solution.h"
+
+#include <algorithm>
+#include <deque>
+#include <stdexcept>
+
+static const int NOT_VISITED = -1;
+static const int START = 4;
+
+static char MoveChar(Direction d, bool push) {
+  static const char MOVE_CHARS[] = "udlr";
+  static const char PUSH_CHARS[] = "UDLR";
+  return push ? PUSH_CHARS[(int)d] : MOVE_CHARS[(int)d];
+}
+
+std::string ExpandPushes(Board &board, const std::vector<Push> &pushes) {
+  std::string result;
+  std::vector<int> visitedFrom(board.Size());
+  std::deque<Position> queue;
+  std::string walk;
+
+  for (const Push &push : pushes) {
+    // Find the shortest walk to the square behind the box by BFS.
+    Position target = board.UnmovePosition(push.Box(), push.Direction());
+    std::fill(visitedFrom.begin(), visitedFrom.end(), NOT_VISITED);
+    visitedFrom[board.Player()] = START;
+    queue.clear();
+    queue.push_back(board.Player());
+    while (!queue.empty() && visitedFrom[target] == NOT_VISITED) {
+      Position p = queue.front();
+      queue.pop_front();
+      for (Direction d : ALL_DIRECTIONS) {
+        Position p2 = board.MovePosition(p, d);
+        if (visitedFrom[p2] == NOT_VISITED && !board.HasWall(p2) &&
+            !board.HasBox(p2)) {
+          visitedFrom[p2] = (int)d;
+          queue.push_back(p2);
+        }
+      }
+    }
+    if (visitedFrom[target] == NOT_VISITED) {
+      throw std::logic_error("unreachable push in solution");
+    }
+
+    // Trace the walk back to the player.
+    walk.clear();
+    for (Position p = target; visitedFrom[p] != START;) {
+      Direction d = (Direction)visitedFrom[p];
+      walk.push_back(MoveChar(d, false));
+      p = board.UnmovePosition(p, d);
+    }
+    result.append(walk.rbegin(), walk.rend());
+    result.push_back(MoveChar(push.Direction(), true));
+
+    board.MovePlayer(target);
+    board.PerformPush(push);
+  }
+
+  return result;
+}
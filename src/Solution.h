@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Board.h"
+
+// Expands a sequence of pushes into player moves in LURD notation, where
+// lowercase letters are moves and uppercase letters are pushes. The board is
+// expected to be in the initial state and is left in the solved state.
+std::string ExpandPushes(Board &board, const std::vector<Push> &pushes);
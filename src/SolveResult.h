@@ -1,12 +1,47 @@
 #pragma once
 
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct WorkerStats {
+  int statesVisited;
+  size_t messagesReceived;
+  size_t maxBacklog;
+  int bipartiteDeadlocks;
+  int corralDeadlocks;
+};
+
+struct AnytimeIteration {
+  double weight;
+  int statesVisited;
+  int pushesRequired;
+};
+
 struct SolveResult {
   bool solved;
   int statesVisited;
   int pushesRequired;
+  size_t memoryUsed;
+  int statesEvicted = 0;
+  bool memoryExhausted = false;
+  bool interrupted = false;
+  size_t deadlockPatterns = 0;
+  int bipartiteDeadlocks = 0;
+  int corralDeadlocks = 0;
+  int symmetricTranspositions = 0;
+  std::optional<double> suboptimalityBound;
+  std::vector<AnytimeIteration> iterations;
+  std::string solution;
+  std::vector<WorkerStats> workerStats;
 
-  SolveResult(bool solved, int statesVisited, int pushesRequired)
+  SolveResult(bool solved,
+              int statesVisited,
+              int pushesRequired,
+              size_t memoryUsed)
       : solved(solved),
         statesVisited(statesVisited),
-        pushesRequired(pushesRequired) {}
+        pushesRequired(pushesRequired),
+        memoryUsed(memoryUsed) {}
 };
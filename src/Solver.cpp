@@ -1,50 +1,53 @@
 #include <cassert>
+#include <chrono>
+#include <cstring>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <memory>
-#include <queue>
-#include <unordered_map>
-#include <unordered_set>
 
+#include "Checkpoint.h"
+#include "MemoryBudget.h"
+#include "Solution.h"
 #include "Solver.h"
 
-struct SearchState {
-  uint64_t id;
-  Position player;
-  std::vector<Position> boxes;
-  std::vector<Push> pushes;
-  int aStarGValue;
-  int aStarHValue;
-  bool isPICorral;
-
-  int AStarFValue() const { return aStarGValue + aStarHValue; }
-
-  SearchState(uint64_t id,
-              Position player,
-              const std::vector<Position> &boxes,
-              const std::vector<Push> &pushes,
-              int aStarGValue,
-              int aStarHValue,
-              bool isPICorral)
-      : id(id),
-        player(player),
-        boxes(boxes),
-        pushes(pushes),
-        aStarGValue(aStarGValue),
-        aStarHValue(aStarHValue),
-        isPICorral(isPICorral) {
-    assert(this->pushes.size() == this->pushes.capacity());
-    assert(this->boxes.size() == this->boxes.capacity());
-  }
-};
+// Number of expansions between checks for checkpointing.
+static const int CHECKPOINT_CHECK_INTERVAL = 1024;
 
-Solver::Solver(Board &board, int maxStates)
+// Amount by which each anytime iteration lowers the weight.
+static const double ANYTIME_WEIGHT_STEP = 0.5;
+
+Solver::Solver(Board &board, const SolverOptions &options)
     : board(board),
       simpleDeadlockDetector(board),
       freezeDeadlockDetector(board, simpleDeadlockDetector),
-      pushSearcher(board, simpleDeadlockDetector),
-      distanceTable(board),
-      maxStates(maxStates) {}
+      corralDeadlockDetector(board, simpleDeadlockDetector),
+      pushSearcher(board,
+                   simpleDeadlockDetector,
+                   &corralDeadlockDetector,
+                   options.reachability),
+      distanceTable(board, options.heuristic, options.patternDatabase),
+      bipartiteDeadlockDetector(board, distanceTable),
+      options(options),
+      lazyPushes(options.lazyPushes),
+      weight(options.weight),
+      canonicalized(false) {
+  if (options.learnDeadlocks) {
+    deadlockDatabase.emplace(board, simpleDeadlockDetector);
+  }
+  if (options.symmetry) {
+    symmetry.emplace(board);
+    if (symmetry->Count() == 1) {
+      symmetry.reset();
+    }
+  }
+  if (options.goalRoomMacros) {
+    goalRoom.emplace(board);
+    if (!goalRoom->Found()) {
+      goalRoom.reset();
+    }
+  }
+}
 
 static void OutputDebugHash(std::ostream &debugFile, uint64_t hash) {
   std::ios oldState(nullptr);
@@ -82,6 +85,10 @@ enum class PushType {
   OPEN_ALREADY,
   DEADLOCK,
   CLOSED,
+  IMPROVED,
+  REOPENED,
+  INCONSISTENT,
+  BOUNDED,
 };
 
 static void OutputDebugPush(std::ostream &debugFile,
@@ -116,122 +123,576 @@ static void OutputDebugPush(std::ostream &debugFile,
   case PushType::CLOSED:
     debugFile << " (pruned: closed)";
     break;
+  case PushType::IMPROVED:
+    debugFile << " (improved: open already)";
+    break;
+  case PushType::REOPENED:
+    debugFile << " (improved: reopened)";
+    break;
+  case PushType::INCONSISTENT:
+    debugFile << " (improved: inconsistent)";
+    break;
+  case PushType::BOUNDED:
+    debugFile << " (pruned: bounded)";
+    break;
   }
   debugFile << std::endl;
 }
 
+int Solver::PerformMacroPush(const Push &push) {
+  macroPushes.clear();
+  if (!goalRoom || !goalRoom->FindMacro(push, macroPushes)) {
+    int length = options.tunnelMacros ? pushSearcher.TunnelLength(push) : 1;
+    Position box = push.Box();
+    for (int i = 0; i < length; i++) {
+      macroPushes.emplace_back(box, push.Direction());
+      box = board.MovePosition(box, push.Direction());
+    }
+  }
+  for (const Push &p : macroPushes) {
+    board.PerformPush(p);
+  }
+  return macroPushes.size();
+}
+
+void Solver::PerformMacroUnpush() {
+  if (canonicalized) {
+    board.ResetState(uncanonicalPlayer, uncanonicalBoxes);
+    canonicalized = false;
+  }
+  for (auto it = macroPushes.rbegin(); it != macroPushes.rend(); ++it) {
+    board.PerformUnpush(*it);
+  }
+}
+
+void Solver::ExpandMacroPushes(std::vector<Push> &pushes) {
+  // N.B., macros are stored as their first push. Which macro a push starts
+  // depends only on the boxes, so replaying the path recovers it.
+  std::vector<Push> expanded;
+  for (const Push &push : pushes) {
+    PerformMacroPush(push);
+    expanded.insert(expanded.end(), macroPushes.begin(), macroPushes.end());
+  }
+  pushes = expanded;
+}
+
+int Solver::Canonicalize() {
+  // Find the transforms giving the boxes the least hash. N.B., transforms
+  // that give the same boxes are told apart by the normalized player.
+  std::vector<int> &candidates = canonicalCandidates;
+  candidates.assign(1, 0);
+  uint64_t bestHash = symmetry->BoxHash(0, board.Boxes());
+  for (int transform = 1; transform < symmetry->Count(); transform++) {
+    uint64_t hash = symmetry->BoxHash(transform, board.Boxes());
+    if (hash < bestHash) {
+      candidates.assign(1, transform);
+      bestHash = hash;
+    } else if (hash == bestHash) {
+      candidates.push_back(transform);
+    }
+  }
+  if (candidates.size() == 1 && candidates[0] == 0) {
+    return 0;
+  }
+
+  uncanonicalPlayer = board.Player();
+  uncanonicalBoxes = board.Boxes();
+  int best = candidates[0];
+  if (candidates.size() > 1) {
+    Position bestPlayer = -1;
+    for (int transform : candidates) {
+      TransformBoard(transform);
+      Position player = pushSearcher.FindNormalizedPlayer();
+      if (bestPlayer == -1 || player < bestPlayer) {
+        best = transform;
+        bestPlayer = player;
+      }
+    }
+  }
+  TransformBoard(best);
+  canonicalized = best != 0;
+  return best;
+}
+
+void Solver::TransformBoard(int transform) {
+  transformedBoxes.clear();
+  for (Position box : uncanonicalBoxes) {
+    transformedBoxes.push_back(symmetry->Transform(transform, box));
+  }
+  board.ResetState(symmetry->Transform(transform, uncanonicalPlayer),
+                   transformedBoxes);
+}
+
+void Solver::GetSolutionPath(const StateStore &states,
+                             StateId id,
+                             std::vector<Push> &path) const {
+  std::vector<StateId> ids;
+  for (; id != NO_STATE; id = states.Parent(id)) {
+    ids.push_back(id);
+  }
+  std::reverse(ids.begin(), ids.end());
+
+  // Each push is made in its parent's stored frame, so map it back through
+  // the transforms taken so far to the initial state's frame.
+  std::vector<Position> toInitial(board.Size());
+  for (Position p = 0; p < board.Size(); p++) {
+    toInitial[p] = p;
+  }
+  std::vector<Position> mapped(board.Size());
+  path.clear();
+  for (int i = 1; i < ids.size(); i++) {
+    Push push = states.ParentPush(ids[i]);
+    Position box = toInitial[push.Box()];
+    Position to =
+        toInitial[board.MovePosition(push.Box(), push.Direction())];
+    for (Direction d : ALL_DIRECTIONS) {
+      if (board.MovePosition(box, d) == to) {
+        path.emplace_back(box, d);
+      }
+    }
+    int transform = states.ParentTransform(ids[i]);
+    if (transform != 0) {
+      for (Position p = 0; p < board.Size(); p++) {
+        mapped[p] = toInitial[symmetry->Untransform(transform, p)];
+      }
+      toInitial.swap(mapped);
+    }
+  }
+}
+
+PushSearchResult Solver::FindChildPushes(std::vector<Push> &pushes) {
+  // N.B., in lazy mode only the normalized player is needed up front.
+  if (lazyPushes) {
+    pushes.clear();
+    return PushSearchResult(pushSearcher.FindNormalizedPlayer(), false);
+  }
+  return pushSearcher.FindPushes(pushes);
+}
+
+uint64_t Solver::CheckpointFingerprint() const {
+  // N.B., settings which only order or speed up the search (e.g., the open
+  // list or lazy pushes) leave stored states compatible.
+  uint64_t weightBits;
+  std::memcpy(&weightBits, &options.weight, sizeof(weightBits));
+  return ComputeFingerprint(
+      board, {(uint64_t)options.heuristic, options.patternDatabase != nullptr,
+              weightBits, options.anytime, options.tunnelMacros,
+              options.goalRoomMacros, options.symmetry});
+}
+
+void Solver::WriteCheckpoint(uint64_t fingerprint,
+                             const StateStore &states,
+                             const StateTable &stateTable,
+                             int statesVisited,
+                             int solutionPushes,
+                             StateId solutionState,
+                             const std::vector<AnytimeIteration> &iterations) {
+  // N.B., the open list is implied by the open states in the state table.
+  // Anytime search also saves its current weight and incumbent solution.
+  CheckpointWriter writer(options.checkpointPath, fingerprint);
+  uint64_t weightBits;
+  std::memcpy(&weightBits, &weight, sizeof(weightBits));
+  writer.Write(std::vector<uint64_t>{(uint64_t)statesVisited, lazyPushes,
+                                     weightBits, (uint64_t)solutionPushes,
+                                     solutionState});
+  writer.Write(iterations);
+  states.Write(writer);
+  stateTable.Write(writer);
+  writer.Commit();
+}
+
+int Solver::ReadCheckpoint(uint64_t fingerprint,
+                           StateStore &states,
+                           StateTable &stateTable,
+                           OpenList &openList,
+                           int &solutionPushes,
+                           StateId &solutionState,
+                           std::vector<AnytimeIteration> &iterations) {
+  CheckpointReader reader(options.checkpointPath, fingerprint);
+  std::vector<uint64_t> header;
+  reader.Read(header);
+  if (header.size() != 5) {
+    throw std::runtime_error("bad checkpoint: " + options.checkpointPath);
+  }
+  lazyPushes = header[1];
+  std::memcpy(&weight, &header[2], sizeof(weight));
+  solutionPushes = (int)header[3];
+  solutionState = header[4];
+  reader.Read(iterations);
+  states.Read(reader);
+  stateTable.Read(reader);
+  for (const StateTableSlot &slot : stateTable.Slots()) {
+    if (slot.id != NO_STATE && slot.status == StateStatus::OPEN) {
+      int gValue = states.GValue(slot.id);
+      int hValue = states.HValue(slot.id);
+      openList.Push(slot.id, Priority(gValue, hValue), gValue, hValue);
+    }
+  }
+  return header[0];
+}
+
+void Solver::BeginIteration(const StateStore &states,
+                            StateTable &stateTable,
+                            OpenList &openList) {
+  // As in ARA*, re-key open states for the new weight, re-open inconsistent
+  // states, and reuse states closed so far as if they were not closed.
+  for (StateTableSlot &slot : stateTable.Slots()) {
+    if (slot.id == NO_STATE) {
+      continue;
+    }
+    int gValue = states.GValue(slot.id);
+    int hValue = states.HValue(slot.id);
+    switch (slot.status) {
+    case StateStatus::OPEN:
+      openList.Update(slot.id, Priority(gValue, hValue), gValue, hValue);
+      break;
+    case StateStatus::INCONSISTENT:
+      slot.status = StateStatus::OPEN;
+      openList.Push(slot.id, Priority(gValue, hValue), gValue, hValue);
+      break;
+    case StateStatus::CLOSED:
+      slot.status = StateStatus::STALE;
+      break;
+    case StateStatus::STALE:
+      break;
+    }
+  }
+}
+
+int Solver::LowerBound(const StateStore &states,
+                       const StateTable &stateTable,
+                       int solutionPushes) const {
+  // N.B., any cheaper solution must pass through an open or inconsistent
+  // state, whose f-value bounds the solution's length from below.
+  int result = solutionPushes;
+  for (const StateTableSlot &slot : stateTable.Slots()) {
+    if (slot.id != NO_STATE && (slot.status == StateStatus::OPEN ||
+                                slot.status == StateStatus::INCONSISTENT)) {
+      result = std::min(result, states.FValue(slot.id));
+    }
+  }
+  return result;
+}
+
 SolveResult Solver::Solve(std::ostream *debugFile) {
   if (board.Done()) {
-    return SolveResult(true, 0, 0);
+    return SolveResult(true, 0, 0, 0);
   }
 
   std::vector<Push> pushes;
+  std::vector<Push> currPushes;
+  std::vector<Position> currBoxes;
+  GoalAssignment currAssignment;
   int statesVisited = 0;
+  int bipartiteDeadlocks = 0;
+  int corralDeadlocks = 0;
+  int symmetricTranspositions = 0;
   int solutionPushes = -1;
+  StateId solutionState = NO_STATE;
+  std::vector<AnytimeIteration> iterations;
+  Position initialPlayer = board.Player();
+  std::vector<Position> initialBoxes = board.Boxes();
+  uint64_t fingerprint = ComputeFingerprint(board);
+  uint64_t checkpointFingerprint = CheckpointFingerprint();
+  bool checkpointing = !options.checkpointPath.empty();
+  bool interrupted = false;
+  bool complete = false;
+  auto lastCheckpoint = std::chrono::steady_clock::now();
+
+  StateStore states(board);
+  std::unique_ptr<OpenList> openStatesQueue =
+      OpenList::Create(options.openList, options.tieBreak);
+  StateTable stateTable(states);
+  std::optional<MemoryBudget> memoryBudget;
+  if (options.maxMemoryBytes > 0) {
+    memoryBudget.emplace(
+        options.maxMemoryBytes, states, stateTable, *openStatesQueue,
+        deadlockDatabase ? &*deadlockDatabase : nullptr, corralDeadlockDetector,
+        [this](int gValue, int hValue) { return Priority(gValue, hValue); });
+  }
+  bool memoryExhausted = false;
+
+  // Start from previously learned deadlock patterns, if any.
+  bool persistDeadlocks =
+      deadlockDatabase && !options.deadlockDatabasePath.empty();
+  if (persistDeadlocks && std::ifstream(options.deadlockDatabasePath).good()) {
+    CheckpointReader reader(options.deadlockDatabasePath, fingerprint);
+    deadlockDatabase->Read(reader);
+  }
+
+  if (options.resume) {
+    // Continue from the checkpointed open and closed states.
+    statesVisited =
+        ReadCheckpoint(checkpointFingerprint, states, stateTable,
+                       *openStatesQueue, solutionPushes, solutionState,
+                       iterations);
+  } else {
+    // Find pushes and normalize the board.
+    PushSearchResult pushSearchResult = FindChildPushes(pushes);
+    board.MovePlayer(pushSearchResult.normalizedPlayer);
+
+    int initialHValue = distanceTable.EstimateDistance(board.Boxes());
+    states.Pack(board);
+    StateId initialState =
+        states.Add(pushes, 0, initialHValue, pushSearchResult.isPICorral);
+    states.MarkReached(initialState, 0);
+    openStatesQueue->Push(initialState, Priority(0, initialHValue), 0,
+                          initialHValue);
+    stateTable.Insert(board.Hash(), initialState, StateStatus::OPEN);
+  }
 
-  auto compare = [](std::shared_ptr<SearchState> s1,
-                    std::shared_ptr<SearchState> s2) {
-    return s1->AStarFValue() >= s2->AStarFValue();
-  };
-  std::priority_queue<std::shared_ptr<SearchState>,
-                      std::vector<std::shared_ptr<SearchState>>,
-                      decltype(compare)>
-      openStatesQueue(compare);
-  std::unordered_map<uint64_t, std::shared_ptr<SearchState>> openStates;
-  std::unordered_set<uint64_t> closedStates;
-
-  // Find pushes and normalize the board.
-  PushSearchResult pushSearchResult = pushSearcher.FindPushes(pushes);
-  board.MovePlayer(pushSearchResult.normalizedPlayer);
-
-  int initialHValue = distanceTable.EstimateDistance(board.Boxes());
-  std::shared_ptr<SearchState> initialState = std::make_shared<SearchState>(
-      board.Hash(), board.Player(), board.Boxes(), pushes, 0, initialHValue,
-      pushSearchResult.isPICorral);
-  openStatesQueue.emplace(initialState);
-  openStates[initialState->id] = initialState;
-
-  while (!openStatesQueue.empty() && statesVisited < maxStates) {
-    // Get current node, remove from open list, add to closed list.
-    std::shared_ptr<SearchState> currState = openStatesQueue.top();
-    openStatesQueue.pop();
-    openStates.erase(currState->id);
-    closedStates.insert(currState->id);
+  // N.B., the state limit applies to each run separately.
+  int maxStates = statesVisited + options.maxStates;
+  while (statesVisited < maxStates) {
+    // Anytime search also lowers the weight once the open list is exhausted,
+    // as inconsistent states may remain.
+    if (openStatesQueue->Empty()) {
+      if (!options.anytime || weight <= 1) {
+        break;
+      }
+      weight = std::max(1.0, weight - ANYTIME_WEIGHT_STEP);
+      BeginIteration(states, stateTable, *openStatesQueue);
+      continue;
+    }
+
+    // Keep within the memory budget, degrading the search if necessary.
+    if (memoryBudget && !memoryBudget->Enforce(board, lazyPushes)) {
+      memoryExhausted = true;
+      break;
+    }
+
+    // Checkpoint periodically, and stop once asked to terminate.
+    if (checkpointing && statesVisited % CHECKPOINT_CHECK_INTERVAL == 0) {
+      if (TerminationRequested()) {
+        interrupted = true;
+        break;
+      }
+      auto now = std::chrono::steady_clock::now();
+      if (now - lastCheckpoint >=
+          std::chrono::seconds(options.checkpointInterval)) {
+        WriteCheckpoint(checkpointFingerprint, states, stateTable,
+                        statesVisited, solutionPushes, solutionState,
+                        iterations);
+        lastCheckpoint = now;
+      }
+    }
+
+    // Get current node and reset board state.
+    StateId currState = openStatesQueue->Pop();
+    states.Restore(currState, board);
+
+    // Move from open list to closed list.
+    StateTableSlot *currSlot = stateTable.Find(board.Hash(), currState);
+    assert(currSlot && currSlot->status == StateStatus::OPEN);
+    currSlot->status = StateStatus::CLOSED;
+    states.SetExpanded(currState);
+    int currGValue = states.GValue(currState);
+    bool currIsPICorral = states.IsPICorral(currState);
     statesVisited++;
 
-    // Reset board state.
-    board.ResetState(currState->player, currState->boxes);
+    // Skip states which cannot improve on the solution found so far.
+    if (solutionState != NO_STATE &&
+        states.FValue(currState) >= solutionPushes) {
+      continue;
+    }
 
-    // Check if done.
+    // Check if done. Anytime search then continues with a lower weight.
     if (board.Done()) {
-      solutionPushes = currState->aStarGValue;
-      break;
+      solutionPushes = currGValue;
+      solutionState = currState;
+      iterations.push_back({weight, statesVisited, solutionPushes});
+      if (!options.anytime || weight <= 1) {
+        complete = true;
+        break;
+      }
+      weight = std::max(1.0, weight - ANYTIME_WEIGHT_STEP);
+      BeginIteration(states, stateTable, *openStatesQueue);
+      continue;
+    }
+
+    // Get pushes, regenerating them if they were not stored.
+    // N.B., lazily generated children skip the corral deadlock check, so it
+    // is made here instead.
+    bool currIsCorralDeadlock = false;
+    if (lazyPushes) {
+      PushSearchResult pushSearchResult = pushSearcher.FindPushes(currPushes);
+      currIsPICorral = pushSearchResult.isPICorral;
+      currIsCorralDeadlock = pushSearchResult.isCorralDeadlock;
+    } else {
+      states.GetPushes(currState, currPushes);
     }
 
     // Debug output.
     if (debugFile) {
-      OutputDebugState(*debugFile, board, statesVisited, currState->aStarGValue,
-                       currState->aStarHValue, currState->isPICorral);
+      OutputDebugState(*debugFile, board, statesVisited, currGValue,
+                       states.HValue(currState), currIsPICorral);
     }
 
-    // Generate children.
-    for (const Push &p : currState->pushes) {
+    // Leave deadlocked states closed without children.
+    if (currIsCorralDeadlock) {
+      corralDeadlocks++;
+      if (debugFile) {
+        *debugFile << "corral deadlock" << std::endl << std::endl;
+      }
+      continue;
+    }
+
+    // Generate children. N.B., until the final anytime iteration, improved
+    // closed states are deferred to the next iteration.
+    bool deferring = options.anytime && weight > 1;
+    bool assigned = false;
+    bool matched = false;
+    currBoxes = board.Boxes();
+    for (const Push &p : currPushes) {
       // Mutate board.
-      board.PerformPush(p);
+      int movedBox = board.BoxIndex(p.Box());
+      int length = PerformMacroPush(p);
 
       // Check for potential freeze deadlock.
-      Position boxTo = board.MovePosition(p.Box(), p.Direction());
-      if (freezeDeadlockDetector.IsDeadlock(boxTo)) {
+      Position boxTo = board.Boxes()[movedBox];
+      if (freezeDeadlockDetector.IsDeadlock(boxTo) ||
+          (deadlockDatabase && deadlockDatabase->IsDeadlock(boxTo))) {
         if (debugFile) {
           OutputDebugPush(*debugFile, p, board, PushType::DEADLOCK);
           OutputDeadlock(*debugFile, board);
         }
-        board.PerformUnpush(p);
+        PerformMacroUnpush();
         continue;
       }
 
-      // Find pushes and normalize the board.
-      pushSearchResult = pushSearcher.FindPushes(pushes);
-      board.MovePlayer(pushSearchResult.normalizedPlayer);
+      // Check that the boxes can still be matched to distinct goals,
+      // incrementally from the current state's matching.
+      if (!matched) {
+        bipartiteDeadlockDetector.IsDeadlock(currBoxes);
+        matched = true;
+      }
+      if (bipartiteDeadlockDetector.IsDeadlock(board.Boxes(), movedBox)) {
+        bipartiteDeadlocks++;
+        if (debugFile) {
+          OutputDebugPush(*debugFile, p, board, PushType::DEADLOCK);
+          OutputDeadlock(*debugFile, board);
+        }
+        PerformMacroUnpush();
+        continue;
+      }
 
-      // Check if child exists on closed list.
-      if (closedStates.find(board.Hash()) != closedStates.end()) {
+      // Move to the symmetric image of the child that is stored, if any.
+      int transform = symmetry ? Canonicalize() : 0;
+
+      // Find pushes and normalize the board, pruning states whose PI-corral
+      // can never be resolved.
+      PushSearchResult pushSearchResult = FindChildPushes(pushes);
+      if (pushSearchResult.isCorralDeadlock) {
+        corralDeadlocks++;
         if (debugFile) {
-          OutputDebugPush(*debugFile, p, board, PushType::CLOSED);
+          OutputDebugPush(*debugFile, p, board, PushType::DEADLOCK);
+          OutputDeadlock(*debugFile, board);
         }
-        board.PerformUnpush(p);
+        PerformMacroUnpush();
         continue;
       }
+      board.MovePlayer(pushSearchResult.normalizedPlayer);
+
+      // Check if child already exists on the open or closed list.
+      states.Pack(board);
+      StateTableSlot *childSlot = stateTable.Find(board.Hash());
+      int childGValue = currGValue + length;
+      if (childSlot) {
+        StateId childState = childSlot->id;
+        StateStatus status = childSlot->status;
+        // N.B., only hits on states not yet reached in the same orientation
+        // are due to symmetry.
+        if (symmetry && !states.MarkReached(childState, transform)) {
+          symmetricTranspositions++;
+        }
 
-      // Check if we already have an open state (with lower-or-better g value).
-      int childGValue = currState->aStarGValue + 1;
-      auto it = openStates.find(board.Hash());
-      if (it != openStates.end()) {
-        if (childGValue >= it->second->aStarGValue) {
+        // Prune unless this is a cheaper path. Closed states are only
+        // re-opened if enabled, as this is only needed if the heuristic is
+        // inconsistent, or deferred to the next iteration of anytime search.
+        if (childGValue >= states.GValue(childState) ||
+            (status == StateStatus::CLOSED && !options.reopenClosed &&
+             !deferring)) {
           if (debugFile) {
-            OutputDebugPush(*debugFile, p, board, PushType::OPEN_ALREADY);
+            OutputDebugPush(*debugFile, p, board,
+                            status == StateStatus::OPEN ? PushType::OPEN_ALREADY
+                                                        : PushType::CLOSED);
           }
-          board.PerformUnpush(p);
+          PerformMacroUnpush();
           continue;
         }
+
+        // Update the existing state in place.
+        int childHValue = states.HValue(childState);
+        int childPriority = Priority(childGValue, childHValue);
+        states.SetGValue(childState, childGValue);
+        states.SetParent(childState, currState, p, transform);
+        PushType pushType;
+        if (status == StateStatus::OPEN) {
+          openStatesQueue->Update(childState, childPriority, childGValue,
+                                  childHValue);
+          pushType = PushType::IMPROVED;
+        } else if (status == StateStatus::CLOSED && deferring) {
+          childSlot->status = StateStatus::INCONSISTENT;
+          pushType = PushType::INCONSISTENT;
+        } else if (status == StateStatus::INCONSISTENT) {
+          pushType = PushType::INCONSISTENT;
+        } else {
+          childSlot->status = StateStatus::OPEN;
+          openStatesQueue->Push(childState, childPriority, childGValue,
+                                childHValue);
+          pushType = PushType::REOPENED;
+        }
+        if (debugFile) {
+          OutputDebugPush(*debugFile, p, board, pushType);
+        }
+        PerformMacroUnpush();
+        continue;
       }
 
-      // Compute heuristic.
-      int childHValue = distanceTable.EstimateDistance(board.Boxes());
+      // Compute heuristic incrementally from the current state's goal
+      // assignment, pruning deadlocked states and states which cannot improve
+      // on the solution found so far. N.B., transformed children have every
+      // box moved.
+      if (!assigned) {
+        distanceTable.EstimateDistance(currBoxes, currAssignment);
+        assigned = true;
+      }
+      int childHValue =
+          transform != 0
+              ? distanceTable.EstimateDistance(board.Boxes())
+              : distanceTable.UpdateDistance(board.Boxes(), movedBox,
+                                             currAssignment);
+      if (childHValue == DistanceTable::DEADLOCK_DISTANCE) {
+        if (debugFile) {
+          OutputDebugPush(*debugFile, p, board, PushType::DEADLOCK);
+          OutputDeadlock(*debugFile, board);
+        }
+        PerformMacroUnpush();
+        continue;
+      }
+      if (solutionState != NO_STATE &&
+          childGValue + childHValue >= solutionPushes) {
+        if (debugFile) {
+          OutputDebugPush(*debugFile, p, board, PushType::BOUNDED);
+        }
+        PerformMacroUnpush();
+        continue;
+      }
 
       // Debug push.
       if (debugFile) {
         OutputDebugPush(*debugFile, p, board, PushType::OPEN);
       }
 
-      // Update open state.
-      // N.B., note on duplicate states
-      std::shared_ptr<SearchState> childState = std::make_shared<SearchState>(
-          board.Hash(), board.Player(), board.Boxes(), pushes, childGValue,
-          childHValue, pushSearchResult.isPICorral);
-      openStatesQueue.emplace(childState);
-      openStates[childState->id] = childState;
-      board.PerformUnpush(p);
+      // Add open state.
+      StateId childState = states.Add(pushes, childGValue, childHValue,
+                                      pushSearchResult.isPICorral);
+      states.SetParent(childState, currState, p, transform);
+      states.MarkReached(childState, transform);
+      openStatesQueue->Push(childState, Priority(childGValue, childHValue),
+                            childGValue, childHValue);
+      stateTable.Insert(board.Hash(), childState, StateStatus::OPEN);
+      PerformMacroUnpush();
     }
 
     if (debugFile) {
@@ -240,5 +701,63 @@ SolveResult Solver::Solve(std::ostream *debugFile) {
   }
 end_of_search:
 
-  return SolveResult(solutionPushes != -1, statesVisited, solutionPushes);
+  // Checkpoint any unfinished search, so that it may be resumed. N.B., an
+  // anytime search is unfinished until its final solution is found.
+  if (checkpointing && !complete && !openStatesQueue->Empty()) {
+    WriteCheckpoint(checkpointFingerprint, states, stateTable, statesVisited,
+                    solutionPushes, solutionState, iterations);
+  }
+
+  // Save learned deadlock patterns for later runs.
+  if (persistDeadlocks) {
+    CheckpointWriter writer(options.deadlockDatabasePath, fingerprint);
+    deadlockDatabase->Write(writer);
+    writer.Commit();
+  }
+
+  size_t memoryUsed = states.MemoryUsage() + stateTable.MemoryUsage() +
+                      openStatesQueue->MemoryUsage() +
+                      (deadlockDatabase ? deadlockDatabase->MemoryUsage() : 0) +
+                      corralDeadlockDetector.MemoryUsage();
+  SolveResult result(solutionPushes != -1, statesVisited, solutionPushes,
+                     memoryUsed);
+  result.memoryExhausted = memoryExhausted;
+  result.interrupted = interrupted;
+  result.iterations = iterations;
+  result.bipartiteDeadlocks = bipartiteDeadlocks;
+  result.corralDeadlocks = corralDeadlocks;
+  result.symmetricTranspositions = symmetricTranspositions;
+  if (deadlockDatabase) {
+    result.deadlockPatterns = deadlockDatabase->PatternCount();
+  }
+  if (memoryBudget) {
+    result.statesEvicted = memoryBudget->StatesEvicted();
+  }
+
+  // Bound the solution's suboptimality by its weight. N.B., this only holds
+  // for the admissible matching heuristic, and not once goal room macros or
+  // evictions have given up optimality. Anytime search defers improved closed
+  // states rather than pruning them, so the f-values of the remaining open and
+  // inconsistent states bound it more tightly.
+  bool bounded = options.heuristic == Heuristic::MATCHING && !goalRoom &&
+                 result.statesEvicted == 0;
+  if (solutionState != NO_STATE && options.weight > 1 && bounded) {
+    double solutionWeight = iterations.back().weight;
+    int lowerBound = LowerBound(states, stateTable, solutionPushes);
+    result.suboptimalityBound =
+        options.anytime && lowerBound > 0
+            ? std::min(solutionWeight, (double)solutionPushes / lowerBound)
+            : solutionWeight;
+  }
+
+  // Recover the solution from the initial state.
+  if (solutionState != NO_STATE) {
+    GetSolutionPath(states, solutionState, pushes);
+    board.ResetState(initialPlayer, initialBoxes);
+    ExpandMacroPushes(pushes);
+    result.pushesRequired = pushes.size();
+    board.ResetState(initialPlayer, initialBoxes);
+    result.solution = ExpandPushes(board, pushes);
+  }
+  return result;
 }
@@ -1,27 +1,88 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <optional>
 #include <ostream>
 #include <vector>
 
+#include "BipartiteDeadlockDetector.h"
 #include "Board.h"
+#include "DeadlockDatabase.h"
 #include "DistanceTable.h"
 #include "FreezeDeadlockDetector.h"
+#include "GoalRoom.h"
+#include "OpenList.h"
 #include "PushSearcher.h"
 #include "SimpleDeadlockDetector.h"
 #include "SolveResult.h"
+#include "SolverOptions.h"
+#include "StateStore.h"
+#include "StateTable.h"
+#include "Symmetry.h"
 
 class Solver {
 public:
-  Solver(Board &board, int maxStates);
+  Solver(Board &board, const SolverOptions &options);
 
   SolveResult Solve(std::ostream *graphOutput);
 
 private:
+  PushSearchResult FindChildPushes(std::vector<Push> &pushes);
+  int PerformMacroPush(const Push &push);
+  void PerformMacroUnpush();
+  void ExpandMacroPushes(std::vector<Push> &pushes);
+  int Canonicalize();
+  void TransformBoard(int transform);
+  void GetSolutionPath(const StateStore &states,
+                       StateId id,
+                       std::vector<Push> &path) const;
+  uint64_t CheckpointFingerprint() const;
+  void WriteCheckpoint(uint64_t fingerprint,
+                       const StateStore &states,
+                       const StateTable &stateTable,
+                       int statesVisited,
+                       int solutionPushes,
+                       StateId solutionState,
+                       const std::vector<AnytimeIteration> &iterations);
+  int ReadCheckpoint(uint64_t fingerprint,
+                     StateStore &states,
+                     StateTable &stateTable,
+                     OpenList &openList,
+                     int &solutionPushes,
+                     StateId &solutionState,
+                     std::vector<AnytimeIteration> &iterations);
+  void BeginIteration(const StateStore &states,
+                      StateTable &stateTable,
+                      OpenList &openList);
+  int LowerBound(const StateStore &states,
+                 const StateTable &stateTable,
+                 int solutionPushes) const;
+
+  // Key of open states, which weights h-values for weighted search. N.B.,
+  // weighted h-values are capped like deadlock estimates, so that keys of
+  // deadlocked states still fit the open lists' 16-bit f-values.
+  int Priority(int gValue, int hValue) const {
+    return gValue + (int)std::min(weight * hValue, UINT16_MAX / 2.0);
+  }
+
   Board &board;
   SimpleDeadlockDetector simpleDeadlockDetector;
   FreezeDeadlockDetector freezeDeadlockDetector;
+  std::optional<DeadlockDatabase> deadlockDatabase;
+  std::optional<GoalRoom> goalRoom;
+  std::optional<Symmetry> symmetry;
+  CorralDeadlockDetector corralDeadlockDetector;
   PushSearcher pushSearcher;
   DistanceTable distanceTable;
-  int maxStates;
+  BipartiteDeadlockDetector bipartiteDeadlockDetector;
+  SolverOptions options;
+  bool lazyPushes;
+  double weight;
+  std::vector<Push> macroPushes;
+  bool canonicalized;
+  Position uncanonicalPlayer;
+  std::vector<Position> uncanonicalBoxes;
+  std::vector<Position> transformedBoxes;
+  std::vector<int> canonicalCandidates;
 };
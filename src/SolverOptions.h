@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "DistanceTable.h"
+#include "OpenList.h"
+#include "PatternDatabase.h"
+#include "PushSearcher.h"
+
+enum class Algorithm { ASTAR, IDASTAR, BIDIRECTIONAL };
+
+struct SolverOptions {
+  // Search algorithm.
+  Algorithm algorithm = Algorithm::ASTAR;
+
+  // Maximum number of states to expand before giving up.
+  int maxStates = 1000000;
+
+  // Memory budget for the search in bytes, or zero for no budget. Exceeding
+  // the budget first drops stored pushes (as if lazyPushes were set) and then
+  // evicts the least promising open states before giving up.
+  size_t maxMemoryBytes = 0;
+
+  // If set, legal pushes are not stored with open states but regenerated when
+  // a state is expanded, trading expansion time for open list memory.
+  bool lazyPushes = false;
+
+  // Ordering of open states with equal f-values.
+  TieBreak tieBreak = TieBreak::DEEPEST_G;
+
+  // Open list implementation.
+  OpenListType openList = OpenListType::BUCKET;
+
+  // How the player's reachable cells are found when generating pushes.
+  Reachability reachability = Reachability::DFS;
+
+  // Heuristic estimating the pushes left to solve a state.
+  Heuristic heuristic = Heuristic::GREEDY;
+
+  // Pattern database whose estimates are combined with the heuristic's, if
+  // any. N.B., not owned by the solver.
+  const PatternDatabase *patternDatabase = nullptr;
+
+  // Weight applied to h-values, trading solution quality for speed. With an
+  // admissible heuristic, solutions are at most this factor longer than
+  // optimal.
+  double weight = 1.0;
+
+  // If set, search continues after each solution with the weight lowered
+  // towards 1, reusing states found so far, until the solution is optimal.
+  bool anytime = false;
+
+  // If set, deadlocked clusters of boxes found by sub-searches are learned as
+  // patterns during search.
+  bool learnDeadlocks = false;
+
+  // If set, learned deadlock patterns are loaded from this file (if it
+  // exists) and saved back to it, so that later runs start warm.
+  std::string deadlockDatabasePath;
+
+  // If set, boxes pushed into tunnels are pushed through them in a single
+  // step, which still counts each push.
+  bool tunnelMacros = false;
+
+  // If set, boxes pushed into a goal room with a single entrance are pushed
+  // straight onto the room's next goal in a precomputed packing order. N.B.,
+  // this commits to one packing order, so solutions may not be optimal.
+  bool goalRoomMacros = false;
+
+  // If set, states are stored as their canonical image under the level's
+  // symmetries, so that symmetric states are only searched once.
+  bool symmetry = false;
+
+  // If set, closed states are re-opened when a cheaper path to them is found.
+  bool reopenClosed = false;
+
+  // If set, unfinished searches are checkpointed to this file, periodically
+  // and when stopped (e.g., by SIGTERM).
+  std::string checkpointPath;
+
+  // Minimum number of seconds between periodic checkpoints.
+  int checkpointInterval = 600;
+
+  // If set, the search is resumed from the checkpoint file, which must have
+  // been taken with the same level and state-affecting settings.
+  bool resume = false;
+
+  // Number of worker threads; more than one selects parallel search.
+  int threads = 1;
+
+  // Size of the IDA* transposition table.
+  size_t transpositionTableBytes = 64 << 20;
+};
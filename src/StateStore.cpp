@@ -0,0 +1,147 @@
+#include "StateStore.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+StateStore::StateStore(const Board &board)
+    : recordWidth(1 + board.Boxes().size()),
+      packed(recordWidth),
+      boxesBuffer(board.Boxes().size()) {
+  // N.B., push codes pack the box position and direction into 16 bits.
+  if (board.Size() * 4 > std::numeric_limits<uint16_t>::max() + 1) {
+    throw std::invalid_argument("board too large: " +
+                                std::to_string(board.Width()) + "x" +
+                                std::to_string(board.Height()));
+  }
+}
+
+void StateStore::Pack(const Board &board) {
+  packed[0] = board.Player();
+  std::copy(board.Boxes().begin(), board.Boxes().end(), packed.begin() + 1);
+  std::sort(packed.begin() + 1, packed.end());
+}
+
+void StateStore::Pack(const uint16_t *record) {
+  std::copy(record, record + recordWidth, packed.begin());
+}
+
+bool StateStore::Matches(StateId id) const {
+  return std::equal(packed.begin(), packed.end(), Record(id));
+}
+
+StateId StateStore::Add(const std::vector<Push> &pushes,
+                        int gValue,
+                        int hValue,
+                        bool isPICorral) {
+  assert(gValue <= std::numeric_limits<uint16_t>::max());
+  assert(hValue <= std::numeric_limits<uint16_t>::max());
+  if (infos.size() >= NO_STATE ||
+      pushCodes.size() + pushes.size() > std::numeric_limits<uint32_t>::max()) {
+    throw std::length_error("state store exhausted");
+  }
+
+  // Store the packed record, recycling a freed state if possible.
+  StateId id;
+  StateInfo info;
+  if (!freeIds.empty()) {
+    id = freeIds.back();
+    freeIds.pop_back();
+    std::copy(packed.begin(), packed.end(), Record(id));
+    info = infos[id];
+    if (pushes.size() > info.pushCount) {
+      info.pushOffset = pushCodes.size();
+    }
+  } else {
+    id = infos.size();
+    records.insert(records.end(), packed.begin(), packed.end());
+    infos.emplace_back();
+    info.pushOffset = pushCodes.size();
+  }
+
+  // Pack pushes.
+  info.parent = NO_STATE;
+  info.parentPush = 0;
+  info.parentTransform = 0;
+  info.reachedTransforms = 0;
+  info.pushCount = pushes.size();
+  info.gValue = gValue;
+  info.hValue = hValue;
+  info.isPICorral = isPICorral;
+  info.isExpanded = false;
+  for (size_t i = 0; i < pushes.size(); i++) {
+    uint16_t code = EncodePush(pushes[i]);
+    if (info.pushOffset + i < pushCodes.size()) {
+      pushCodes[info.pushOffset + i] = code;
+    } else {
+      pushCodes.push_back(code);
+    }
+  }
+  infos[id] = info;
+
+  return id;
+}
+
+void StateStore::Restore(StateId id, Board &board) {
+  const uint16_t *record = Record(id);
+  for (int i = 1; i < recordWidth; i++) {
+    boxesBuffer[i - 1] = record[i];
+  }
+  board.ResetState(record[0], boxesBuffer);
+}
+
+void StateStore::GetPushes(StateId id, std::vector<Push> &pushes) const {
+  const StateInfo &info = infos[id];
+  pushes.clear();
+  for (int i = 0; i < info.pushCount; i++) {
+    pushes.push_back(DecodePush(pushCodes[info.pushOffset + i]));
+  }
+}
+
+void StateStore::GetPath(StateId id, std::vector<Push> &path) const {
+  path.clear();
+  for (; Parent(id) != NO_STATE; id = Parent(id)) {
+    path.push_back(ParentPush(id));
+  }
+  std::reverse(path.begin(), path.end());
+}
+
+void StateStore::Free(StateId id) {
+  assert(id < infos.size());
+  freeIds.push_back(id);
+}
+
+void StateStore::DropPushes() {
+  pushCodes.clear();
+  pushCodes.shrink_to_fit();
+  for (StateInfo &info : infos) {
+    info.pushOffset = 0;
+    info.pushCount = 0;
+  }
+}
+
+void StateStore::Write(CheckpointWriter &writer) const {
+  writer.Write(records);
+  writer.Write(pushCodes);
+  writer.Write(infos);
+  writer.Write(freeIds);
+}
+
+void StateStore::Read(CheckpointReader &reader) {
+  reader.Read(records);
+  reader.Read(pushCodes);
+  reader.Read(infos);
+  reader.Read(freeIds);
+  if (records.size() != infos.size() * recordWidth) {
+    throw std::runtime_error("checkpoint state records do not match board");
+  }
+}
+
+size_t StateStore::MemoryUsage() const {
+  return (records.capacity() + packed.capacity()) * sizeof(uint16_t) +
+         pushCodes.capacity() * sizeof(uint16_t) +
+         infos.capacity() * sizeof(StateInfo) +
+         freeIds.capacity() * sizeof(StateId);
+}
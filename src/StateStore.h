@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Board.h"
+#include "Checkpoint.h"
+
+typedef uint32_t StateId;
+
+constexpr StateId NO_STATE = UINT32_MAX;
+
+// Stores search states as fixed-width records in a contiguous arena. Each
+// record holds the (normalized) player position followed by the box positions
+// in sorted order, so that equal states always pack to identical records.
+// Legal pushes are packed into a second arena as 16-bit push codes. Each state
+// also records its parent and the push leading from it, for recovering
+// solutions.
+//
+// States are added in two steps: Pack() encodes the board into a scratch
+// record, which may then be compared against stored states with Matches() and
+// finally stored with Add(). Freed states are recycled by later calls to Add().
+class StateStore {
+public:
+  StateStore(const Board &board);
+
+  void Pack(const Board &board);
+  void Pack(const uint16_t *record);
+  const uint16_t *Packed() const { return packed.data(); }
+  bool Matches(StateId id) const;
+  StateId Add(const std::vector<Push> &pushes,
+              int gValue,
+              int hValue,
+              bool isPICorral);
+
+  void Restore(StateId id, Board &board);
+  void GetPushes(StateId id, std::vector<Push> &pushes) const;
+
+  int GValue(StateId id) const { return infos[id].gValue; }
+  int HValue(StateId id) const { return infos[id].hValue; }
+  void SetGValue(StateId id, int gValue) { infos[id].gValue = gValue; }
+  void SetHValue(StateId id, int hValue) { infos[id].hValue = hValue; }
+  int FValue(StateId id) const { return GValue(id) + HValue(id); }
+  bool IsPICorral(StateId id) const { return infos[id].isPICorral; }
+  bool IsExpanded(StateId id) const { return infos[id].isExpanded; }
+  void SetExpanded(StateId id) { infos[id].isExpanded = true; }
+
+  StateId Parent(StateId id) const { return infos[id].parent; }
+  Push ParentPush(StateId id) const { return DecodePush(infos[id].parentPush); }
+
+  // Symmetry transform (see Symmetry) taking the state reached by the parent
+  // push to the stored state, which is zero unless states are canonicalized.
+  int ParentTransform(StateId id) const { return infos[id].parentTransform; }
+  void SetParent(StateId id,
+                 StateId parent,
+                 const Push &push,
+                 int transform = 0) {
+    infos[id].parent = parent;
+    infos[id].parentPush = EncodePush(push);
+    infos[id].parentTransform = transform;
+  }
+
+  // Records that the state was reached as the given transform's image,
+  // returning whether it had already been reached that way.
+  bool MarkReached(StateId id, int transform) {
+    bool reached = infos[id].reachedTransforms >> transform & 1;
+    infos[id].reachedTransforms |= 1 << transform;
+    return reached;
+  }
+
+  // Recovers the pushes leading from the root state to the given state.
+  void GetPath(StateId id, std::vector<Push> &path) const;
+
+  static uint16_t EncodePush(const Push &push) {
+    return push.Box() * 4 + (int)push.Direction();
+  }
+  static Push DecodePush(uint16_t code) {
+    return Push(code / 4, (Direction)(code % 4));
+  }
+
+  // Releases a state for reuse. N.B., the caller must ensure the state is no
+  // longer referenced, e.g., as a parent.
+  void Free(StateId id);
+  size_t FreeCount() const { return freeIds.size(); }
+
+  // Discards all stored pushes, which must then be regenerated by the caller.
+  void DropPushes();
+
+  void Write(CheckpointWriter &writer) const;
+  void Read(CheckpointReader &reader);
+
+  int RecordWidth() const { return recordWidth; }
+  size_t Size() const { return infos.size() - freeIds.size(); }
+  size_t MemoryUsage() const;
+
+private:
+  struct StateInfo {
+    uint32_t pushOffset;
+    StateId parent;
+    uint16_t parentPush;
+    uint16_t pushCount;
+    uint16_t gValue;
+    uint16_t hValue;
+    bool isPICorral;
+    bool isExpanded;
+    uint8_t parentTransform;
+    uint8_t reachedTransforms;
+  };
+
+  const uint16_t *Record(StateId id) const {
+    return &records[(size_t)id * recordWidth];
+  }
+  uint16_t *Record(StateId id) { return &records[(size_t)id * recordWidth]; }
+
+  int recordWidth;
+  std::vector<uint16_t> packed;
+  std::vector<uint16_t> records;
+  std::vector<uint16_t> pushCodes;
+  std::vector<StateInfo> infos;
+  std::vector<StateId> freeIds;
+  std::vector<Position> boxesBuffer;
+};
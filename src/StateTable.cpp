@@ -0,0 +1,105 @@
+#include "StateTable.h"
+
+#include <cassert>
+#include <stdexcept>
+
+static const size_t INITIAL_CAPACITY = 1024;
+
+StateTable::StateTable(const StateStore &states)
+    : states(states),
+      slots(INITIAL_CAPACITY, {0, NO_STATE, StateStatus::OPEN}),
+      mask(INITIAL_CAPACITY - 1),
+      size(0) {}
+
+StateTableSlot *StateTable::Find(uint64_t hash) {
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    StateTableSlot &slot = slots[i];
+    if (slot.id == NO_STATE) {
+      return nullptr;
+    }
+    if (slot.hash == hash && states.Matches(slot.id)) {
+      return &slot;
+    }
+  }
+}
+
+StateTableSlot *StateTable::Find(uint64_t hash, StateId id) {
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    StateTableSlot &slot = slots[i];
+    if (slot.id == NO_STATE) {
+      return nullptr;
+    }
+    if (slot.id == id) {
+      return &slot;
+    }
+  }
+}
+
+void StateTable::Insert(uint64_t hash, StateId id, StateStatus status) {
+  assert(id != NO_STATE);
+
+  // N.B., keep the load factor at or below 1/2 so probe sequences stay short.
+  if (2 * (size + 1) > slots.size()) {
+    Grow();
+  }
+
+  size_t i = hash & mask;
+  while (slots[i].id != NO_STATE) {
+    i = (i + 1) & mask;
+  }
+  slots[i] = {hash, id, status};
+  size++;
+}
+
+void StateTable::Remove(StateTableSlot *slot) {
+  assert(slot && slot->id != NO_STATE);
+
+  // N.B., shift later entries of the probe sequence back into the hole, so
+  // that no tombstones are needed.
+  size_t hole = slot - slots.data();
+  for (size_t i = (hole + 1) & mask; slots[i].id != NO_STATE;
+       i = (i + 1) & mask) {
+    size_t home = slots[i].hash & mask;
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      slots[hole] = slots[i];
+      hole = i;
+    }
+  }
+  slots[hole] = {0, NO_STATE, StateStatus::OPEN};
+  size--;
+}
+
+void StateTable::Write(CheckpointWriter &writer) const {
+  writer.Write(slots);
+}
+
+void StateTable::Read(CheckpointReader &reader) {
+  reader.Read(slots);
+  if (slots.empty() || (slots.size() & (slots.size() - 1)) != 0) {
+    throw std::runtime_error("bad checkpoint state table");
+  }
+  mask = slots.size() - 1;
+  size = 0;
+  for (const StateTableSlot &slot : slots) {
+    if (slot.id != NO_STATE) {
+      size++;
+    }
+  }
+}
+
+void StateTable::Grow() {
+  std::vector<StateTableSlot> oldSlots(slots.size() * 2,
+                                       {0, NO_STATE, StateStatus::OPEN});
+  oldSlots.swap(slots);
+  mask = slots.size() - 1;
+  for (const StateTableSlot &slot : oldSlots) {
+    if (slot.id == NO_STATE) {
+      continue;
+    }
+    size_t i = slot.hash & mask;
+    while (slots[i].id != NO_STATE) {
+      i = (i + 1) & mask;
+    }
+    slots[i] = slot;
+  }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Checkpoint.h"
+#include "StateStore.h"
+
+enum class StateStatus : uint8_t {
+  OPEN,
+  CLOSED,
+  // Closed states whose g-values improved during the current anytime
+  // iteration, which are re-opened at the start of the next iteration.
+  INCONSISTENT,
+  // States closed during an earlier anytime iteration.
+  STALE,
+};
+
+struct StateTableSlot {
+  uint64_t hash;
+  StateId id;
+  StateStatus status;
+};
+
+// Open-addressing (linear probing) hash table mapping states to their ids in
+// a StateStore. Hash matches are verified against the packed state records,
+// so distinct states with colliding Zobrist hashes are never conflated.
+class StateTable {
+public:
+  StateTable(const StateStore &states);
+
+  // Finds the slot for the state most recently packed into the store, or
+  // returns nullptr if not present. Slot pointers are invalidated by Insert().
+  StateTableSlot *Find(uint64_t hash);
+
+  // Finds the slot which currently refers to the given state id.
+  StateTableSlot *Find(uint64_t hash, StateId id);
+
+  void Insert(uint64_t hash, StateId id, StateStatus status);
+
+  // Removes the given slot, invalidating slot pointers.
+  void Remove(StateTableSlot *slot);
+
+  // N.B., callers may update slot statuses, but nothing else.
+  const std::vector<StateTableSlot> &Slots() const { return slots; }
+  std::vector<StateTableSlot> &Slots() { return slots; }
+
+  void Write(CheckpointWriter &writer) const;
+  void Read(CheckpointReader &reader);
+
+  size_t Size() const { return size; }
+  size_t MemoryUsage() const { return slots.capacity() * sizeof(StateTableSlot); }
+
+private:
+  void Grow();
+
+  const StateStore &states;
+  std::vector<StateTableSlot> slots;
+  size_t mask;
+  size_t size;
+};
@@ -0,0 +1,59 @@
+#include "Symmetry.h"
+
+#include <random>
+#include <utility>
+
+Symmetry::Symmetry(const Board &board) : boxHashTable(board.Size()) {
+  int width = board.Width();
+  int height = board.Height();
+
+  // Try each combination of transposing and flipping either axis. N.B.,
+  // transposing (as part of a rotation or diagonal reflection) requires a
+  // square board.
+  for (int transpose = 0; transpose < 2; transpose++) {
+    if (transpose && width != height) {
+      continue;
+    }
+    for (int flips = 0; flips < 4; flips++) {
+      std::vector<Position> transform(board.Size());
+      std::vector<Position> inverse(board.Size());
+      bool symmetric = true;
+      for (Position p = 0; p < board.Size() && symmetric; p++) {
+        int x = board.PositionX(p);
+        int y = board.PositionY(p);
+        if (transpose) {
+          std::swap(x, y);
+        }
+        if (flips & 1) {
+          x = width - 1 - x;
+        }
+        if (flips & 2) {
+          y = height - 1 - y;
+        }
+        Position q = y * width + x;
+        symmetric = board.HasWall(p) == board.HasWall(q) &&
+                    board.HasGoal(p) == board.HasGoal(q);
+        transform[p] = q;
+        inverse[q] = p;
+      }
+      if (symmetric) {
+        transforms.push_back(transform);
+        inverses.push_back(inverse);
+      }
+    }
+  }
+
+  std::mt19937_64 rnd(0x5eed5eed);
+  for (uint64_t &entry : boxHashTable) {
+    entry = rnd();
+  }
+}
+
+uint64_t Symmetry::BoxHash(int transform,
+                           const std::vector<Position> &boxes) const {
+  uint64_t result = 0;
+  for (Position box : boxes) {
+    result ^= boxHashTable[transforms[transform][box]];
+  }
+  return result;
+}
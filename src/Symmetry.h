@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Board.h"
+
+// Symmetries of the level: reflections and rotations of the board which map
+// walls onto walls and goals onto goals. States related by a symmetry are
+// equally hard to solve, so the solver only needs to search one of them.
+//
+// Transforms are stored as position maps, with the identity first.
+class Symmetry {
+public:
+  Symmetry(const Board &board);
+
+  int Count() const { return transforms.size(); }
+
+  Position Transform(int transform, Position p) const {
+    return transforms[transform][p];
+  }
+  Position Untransform(int transform, Position p) const {
+    return inverses[transform][p];
+  }
+
+  // Zobrist hash of the boxes after the given transform. N.B., the player is
+  // left out, as its normalized position is only known after the transform.
+  uint64_t BoxHash(int transform, const std::vector<Position> &boxes) const;
+
+private:
+  std::vector<std::vector<Position>> transforms;
+  std::vector<std::vector<Position>> inverses;
+  std::vector<uint64_t> boxHashTable;
+};
@@ -0,0 +1,53 @@
+#include "TranspositionTable.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+TranspositionTable::TranspositionTable(size_t sizeBytes) {
+  // Round down to a power-of-two number of buckets of two entries each.
+  size_t buckets = 1;
+  while (buckets * 4 * sizeof(TranspositionEntry) <= sizeBytes) {
+    buckets *= 2;
+  }
+  entries.resize(buckets * 2, {0, 0, 0, 0, false});
+  mask = buckets - 1;
+}
+
+TranspositionEntry *TranspositionTable::Find(uint64_t hash) {
+  TranspositionEntry *bucket = &entries[(hash & mask) * 2];
+  for (int i = 0; i < 2; i++) {
+    // N.B., empty entries have iteration zero; live ones never do.
+    if (bucket[i].hash == hash && bucket[i].iteration != 0) {
+      return &bucket[i];
+    }
+  }
+  return nullptr;
+}
+
+void TranspositionTable::Store(uint64_t hash,
+                               int gValue,
+                               int hValue,
+                               int iteration,
+                               bool inProgress) {
+  assert(iteration > 0);
+  gValue = std::min(gValue, (int)std::numeric_limits<uint16_t>::max());
+  hValue = std::min(hValue, (int)std::numeric_limits<uint16_t>::max());
+
+  TranspositionEntry *entry = Find(hash);
+  if (!entry) {
+    TranspositionEntry *bucket = &entries[(hash & mask) * 2];
+    bool busy0 = bucket[0].inProgress && bucket[0].iteration == iteration;
+    bool busy1 = bucket[1].inProgress && bucket[1].iteration == iteration;
+    if (busy0 != busy1) {
+      entry = busy0 ? &bucket[1] : &bucket[0];
+    } else if (bucket[0].iteration != bucket[1].iteration) {
+      entry = bucket[0].iteration < bucket[1].iteration ? &bucket[0]
+                                                        : &bucket[1];
+    } else {
+      entry = bucket[0].gValue >= bucket[1].gValue ? &bucket[0] : &bucket[1];
+    }
+  }
+  *entry = {hash, (uint16_t)gValue, (uint16_t)hValue, (uint16_t)iteration,
+            inProgress};
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct TranspositionEntry {
+  uint64_t hash;
+  uint16_t gValue;
+  uint16_t hValue;
+  uint16_t iteration;
+  // Set while the entry's subtree is still being searched, i.e., while the
+  // state is on the current search path.
+  bool inProgress;
+};
+
+// Fixed-size transposition table for depth-first search. Entries are kept in
+// two-way buckets; a new entry replaces one from an earlier iteration first
+// and otherwise the one searched at the larger g-value, as it roots the
+// smaller subtree. Entries on the current search path are only replaced if
+// both entries of the bucket are.
+//
+// N.B., entries are matched on the full 64-bit hash only, so an (unlikely)
+// collision may prune a state; this is the usual trade-off for a bounded
+// table.
+class TranspositionTable {
+public:
+  TranspositionTable(size_t sizeBytes);
+
+  TranspositionEntry *Find(uint64_t hash);
+  void Store(uint64_t hash,
+             int gValue,
+             int hValue,
+             int iteration,
+             bool inProgress = false);
+
+  size_t MemoryUsage() const {
+    return entries.capacity() * sizeof(TranspositionEntry);
+  }
+
+private:
+  std::vector<TranspositionEntry> entries;
+  size_t mask;
+};